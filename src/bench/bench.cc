@@ -0,0 +1,214 @@
+// Microbenchmarks of the efsim hot paths at the compiled grid size (one
+// executable per size, see EFSIM_BENCH_SIZES in CMakeLists.txt).
+//
+//   efsim_bench_1024 --kokkos-num-threads=8 --benchmark_filter=Pressure
+//
+// bytes_per_second is effective bandwidth: the declared compulsory DRAM
+// traffic of the kernels a benchmark launches (kernel_costs() in
+// efsim/roofline.cc) divided by its time, so it can be compared against
+// the machine's STREAM figure. Startup fails if a declared kernel is never
+// launched, since its label no longer matches the code.
+// With EFSIM_PERF=1 (Linux), hardware counters per cell are added too.
+#include <Kokkos_Core.hpp>
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+
+#include "efsim/efsim.hh"
+
+// Cells in the grid; all traffic estimates are in bytes per cell
+static const double CELLS = double(WIDTH) * HEIGHT;
+
+static std::unique_ptr<Sim> sim;
+static SimParams params;
+static PerfCounters counters;
+static bool perf = false;
+
+// Counter deltas per cell over a benchmark's timing loop
+class CounterScope {
+public:
+  CounterScope(benchmark::State &state) : state(state) {
+    if (perf)
+      start = counters.read();
+  }
+  ~CounterScope() {
+    if (!perf)
+      return;
+    PerfCounters::Values end = counters.read();
+    double n = state.iterations() * CELLS;
+    for (int c = 0; c < PerfCounters::COUNT; c++)
+      if (counters.available(PerfCounters::Counter(c))) {
+        std::string name = PerfCounters::name(PerfCounters::Counter(c));
+        state.counters[name + "/cell"] = (end[c] - start[c]) / n;
+      }
+  }
+
+private:
+  benchmark::State &state;
+  PerfCounters::Values start = {};
+};
+
+static void setBandwidth(benchmark::State &state, double bytesPerCell) {
+  state.SetBytesProcessed(int64_t(state.iterations() * bytesPerCell * CELLS));
+  state.counters["cells"] = CELLS;
+}
+
+// One call of each benchmarked solver path
+static void advectOnce() { advect(sim->mac, params.dt, params.gravity); }
+static void divergenceOnce() { compute_divergence(sim->mac); }
+static void pressureSweepOnce() { solve_pressure(sim->mac, 1); }
+static void clearDivergenceOnce() {
+  clear_divergence_opti(sim->mac, 1, OVERRELAXATION);
+}
+static void subtractGradientOnce() { subtract_pressure_gradient(sim->mac); }
+static void scalarAdvectOnce() { sim->density.advect(sim->mac, params.dt); }
+static void scalarAdvectVofOnce() {
+  sim->density.advect_vof(sim->mac, params.dt);
+}
+
+// Declared bytes per cell of one call of each path, filled by measureTraffic()
+static std::map<void (*)(), double> traffic;
+
+// Runs each path once under Roofline to see which declared kernels it
+// launches and sums their kernel_costs(). False, after listing them, if
+// a label in the table was never launched (a kernel renamed or removed).
+static bool measureTraffic() {
+  std::set<std::string> seen;
+  for (void (*work)() :
+       {advectOnce, divergenceOnce, pressureSweepOnce, clearDivergenceOnce,
+        subtractGradientOnce, scalarAdvectOnce, scalarAdvectVofOnce}) {
+    Roofline::start();
+    work();
+    Roofline::stop();
+    std::map<std::string, long> launches = Roofline::launches();
+    double bytes = 0.0;
+    for (const KernelCost &cost : kernel_costs()) {
+      auto it = launches.find(cost.label);
+      if (it == launches.end())
+        continue;
+      bytes += cost.items * cost.bytesPerItem * it->second;
+      seen.insert(cost.label);
+    }
+    traffic[work] = bytes / CELLS;
+  }
+  bool ok = true;
+  for (const KernelCost &cost : kernel_costs())
+    if (!seen.count(cost.label)) {
+      std::cerr << "kernel_costs() label \"" << cost.label
+                << "\" was never launched\n";
+      ok = false;
+    }
+  return ok;
+}
+
+static void runPath(benchmark::State &state, void (*work)()) {
+  CounterScope scope(state);
+  for (auto _ : state)
+    work();
+  setBandwidth(state, traffic.at(work));
+}
+
+// xtmp/ytmp written by the two advection kernels, then copied back
+static void BM_Advect(benchmark::State &state) { runPath(state, advectOnce); }
+BENCHMARK(BM_Advect)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ComputeDivergence(benchmark::State &state) {
+  runPath(state, divergenceOnce);
+}
+BENCHMARK(BM_ComputeDivergence)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// One Jacobi sweep
+static void BM_PressureSweep(benchmark::State &state) {
+  runPath(state, pressureSweepOnce);
+}
+BENCHMARK(BM_PressureSweep)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// One red-black iteration, both colours
+static void BM_ClearDivergenceRBGS(benchmark::State &state) {
+  runPath(state, clearDivergenceOnce);
+}
+BENCHMARK(BM_ClearDivergenceRBGS)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+static void BM_SubtractPressureGradient(benchmark::State &state) {
+  runPath(state, subtractGradientOnce);
+}
+BENCHMARK(BM_SubtractPressureGradient)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Scatter and leftover passes; the clears of tmp and beta and the copy
+// back are not kernels with a cost
+static void BM_ScalarAdvect(benchmark::State &state) {
+  runPath(state, scalarAdvectOnce);
+}
+BENCHMARK(BM_ScalarAdvect)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// As ScalarAdvect plus the clamp / overflow pass
+static void BM_ScalarAdvectVof(benchmark::State &state) {
+  runPath(state, scalarAdvectVofOnce);
+}
+BENCHMARK(BM_ScalarAdvectVof)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// xgrid, ygrid, sgrid, pressure and div copied device -> host, so this is
+// link bandwidth. A no-op on host backends, where the DualViews share
+// their memory. Not a kernel, so its bytes are not in kernel_costs().
+static void BM_MacSyncHost(benchmark::State &state) {
+  CounterScope scope(state);
+  for (auto _ : state)
+    sim->mac.sync_host();
+  setBandwidth(state, 20);
+}
+BENCHMARK(BM_MacSyncHost)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Step(benchmark::State &state) {
+  CounterScope scope(state);
+  for (auto _ : state)
+    sim->step(params.dt, params);
+  state.counters["cells"] = CELLS;
+  state.counters["Mcells/s"] = benchmark::Counter(
+      CELLS * 1e-6, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_Step)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+int main(int argc, char **argv) {
+  Kokkos::initialize(argc, argv);
+  {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+      Kokkos::finalize();
+      return 1;
+    }
+    benchmark::AddCustomContext("grid", std::to_string(WIDTH) + "x" +
+                                            std::to_string(HEIGHT));
+    benchmark::AddCustomContext("kokkos_backend",
+                                Kokkos::DefaultExecutionSpace::name());
+    benchmark::AddCustomContext(
+        "kokkos_concurrency",
+        std::to_string(Kokkos::DefaultExecutionSpace().concurrency()));
+
+    if (const char *env = std::getenv("EFSIM_PERF"))
+      perf = env[0] == '1' && counters.open();
+
+    // Let the flow develop so the advection kernels see real velocities
+    sim = std::make_unique<Sim>();
+    for (int k = 0; k < 20; k++)
+      sim->step(params.dt, params);
+    Kokkos::fence();
+
+    if (!measureTraffic()) {
+      sim.reset();
+      Kokkos::finalize();
+      return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    sim.reset();
+  }
+  Kokkos::finalize();
+  return 0;
+}
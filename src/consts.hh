@@ -1,8 +1,16 @@
 #pragma once
-const int WIDTH =1024;
-const int HEIGHT = 1024;
+// Grid size is fixed at compile time; benchmark and sweep builds override
+// it with -DEFSIM_WIDTH=... -DEFSIM_HEIGHT=...
+#ifndef EFSIM_WIDTH
+#define EFSIM_WIDTH 1024
+#endif
+#ifndef EFSIM_HEIGHT
+#define EFSIM_HEIGHT EFSIM_WIDTH
+#endif
+
+const int WIDTH = EFSIM_WIDTH;
+const int HEIGHT = EFSIM_HEIGHT;
 /* const int HEIGHT = 512; */
 /* const int WIDTH =512; */
 
 const bool OVERRELAXATION = false;
-
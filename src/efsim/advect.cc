@@ -45,8 +45,10 @@ void advect(Mac &mac, float deltaTime, float gravity) {
         ytemp.d_view(j, i) = mac.interpolateDevice(px, py).second + gravity * deltaTime;
       });
 
-  Kokkos::fence("Wait for end of compute");
-  Kokkos::deep_copy(mac.xgrid.d_view, xtemp.d_view);
-  Kokkos::deep_copy(mac.ygrid.d_view, ytemp.d_view);
-  Kokkos::fence();
+  // On the solver's instance only, so a readback queued on another
+  // instance keeps running
+  Kokkos::DefaultExecutionSpace exec;
+  Kokkos::deep_copy(exec, mac.xgrid.d_view, xtemp.d_view);
+  Kokkos::deep_copy(exec, mac.ygrid.d_view, ytemp.d_view);
+  exec.fence();
 }
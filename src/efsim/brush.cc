@@ -0,0 +1,67 @@
+#include "brush.hh"
+
+#include <algorithm>
+#include <cmath>
+
+Brush Brush::circle(float cx, float cy, float r, int value) {
+  Brush b;
+  b.shape = Circle;
+  b.value = value;
+  b.radius = r;
+  b.count = 1;
+  b.x[0] = cx;
+  b.y[0] = cy;
+  return b;
+}
+
+Brush Brush::line(float x1, float y1, float x2, float y2, float r,
+                  int value) {
+  Brush b;
+  b.shape = Line;
+  b.value = value;
+  b.radius = r;
+  b.count = 2;
+  b.x[0] = x1;
+  b.y[0] = y1;
+  b.x[1] = x2;
+  b.y[1] = y2;
+  return b;
+}
+
+Brush Brush::rectangle(float x1, float y1, float x2, float y2, int value) {
+  Brush b = line(x1, y1, x2, y2, 0.0f, value);
+  b.shape = Rectangle;
+  return b;
+}
+
+Brush Brush::polygon(const std::vector<std::pair<float, float>> &vertices,
+                     int value) {
+  Brush b;
+  b.shape = Polygon;
+  b.value = value;
+  b.count = std::min(int(vertices.size()), MAX_VERTICES);
+  for (int k = 0; k < b.count; k++) {
+    b.x[k] = vertices[k].first;
+    b.y[k] = vertices[k].second;
+  }
+  return b;
+}
+
+void Brush::bounds(int &i0, int &j0, int &i1, int &j1) const {
+  if (count == 0) {
+    i0 = j0 = 1;
+    i1 = j1 = 0;
+    return;
+  }
+  float lx = x[0], hx = x[0], ly = y[0], hy = y[0];
+  for (int k = 1; k < count; k++) {
+    lx = std::min(lx, x[k]);
+    hx = std::max(hx, x[k]);
+    ly = std::min(ly, y[k]);
+    hy = std::max(hy, y[k]);
+  }
+  i0 = std::max(1, int(std::floor(lx - radius)));
+  j0 = std::max(1, int(std::floor(ly - radius)));
+  i1 = std::min(WIDTH - 2, int(std::floor(hx + radius)));
+  j1 = std::min(HEIGHT - 2, int(std::floor(hy + radius)));
+}
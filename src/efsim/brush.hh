@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Kokkos_Core.hpp>
+#include <utility>
+#include <vector>
+
+#include "consts.hh"
+
+// A shape painted into the obstacle mask in one stroke. Coordinates are in
+// cells, x along i and y along j; a cell is covered if its centre is.
+// Plain data, so the same stroke can be rasterized on device by Mac::paint
+// and on the host by the renderer's copy of the mask.
+struct Brush {
+  enum Shape : int { Circle = 0, Line = 1, Rectangle = 2, Polygon = 3 };
+  static const int MAX_VERTICES = 32;
+
+  Shape shape = Circle;
+  int value = 0;        // 0 = solid, 1 = fluid
+  float radius = 0.0f;  // Circle, Line
+  int count = 0;        // vertices in use
+  float x[MAX_VERTICES] = {};
+  float y[MAX_VERTICES] = {};
+
+  static Brush circle(float cx, float cy, float r, int value);
+  // A thick segment with round caps
+  static Brush line(float x1, float y1, float x2, float y2, float r,
+                    int value);
+  static Brush rectangle(float x1, float y1, float x2, float y2, int value);
+  // Even-odd fill; extra vertices past MAX_VERTICES are dropped
+  static Brush polygon(const std::vector<std::pair<float, float>> &vertices,
+                       int value);
+
+  // Cells that may be covered, clipped to the editable interior (the
+  // domain boundary is never painted). Empty if i0 > i1 or j0 > j1.
+  void bounds(int &i0, int &j0, int &i1, int &j1) const;
+
+  KOKKOS_INLINE_FUNCTION bool covers(int i, int j) const {
+    const float px = i + 0.5f;
+    const float py = j + 0.5f;
+
+    switch (shape) {
+    case Circle: {
+      float dx = px - x[0], dy = py - y[0];
+      return dx * dx + dy * dy <= radius * radius;
+    }
+    case Line: {
+      float ex = x[1] - x[0], ey = y[1] - y[0];
+      float dx = px - x[0], dy = py - y[0];
+      float len2 = ex * ex + ey * ey;
+      float t = len2 > 0.0f ? Kokkos::clamp((dx * ex + dy * ey) / len2,
+                                            0.0f, 1.0f)
+                            : 0.0f;
+      dx -= t * ex;
+      dy -= t * ey;
+      return dx * dx + dy * dy <= radius * radius;
+    }
+    case Rectangle:
+      return px >= Kokkos::min(x[0], x[1]) && px <= Kokkos::max(x[0], x[1]) &&
+             py >= Kokkos::min(y[0], y[1]) && py <= Kokkos::max(y[0], y[1]);
+    case Polygon: {
+      bool inside = false;
+      for (int a = 0, b = count - 1; a < count; b = a++) {
+        if ((y[a] > py) != (y[b] > py) &&
+            px < (x[b] - x[a]) * (py - y[a]) / (y[b] - y[a]) + x[a])
+          inside = !inside;
+      }
+      return inside;
+    }
+    }
+    return false;
+  }
+};
@@ -0,0 +1,316 @@
+#include "checkpoint.hh"
+
+#include <Kokkos_Core.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "consts.hh"
+
+namespace {
+
+const char MAGIC[4] = {'E', 'F', 'C', 'K'};
+const uint32_t VERSION = 1;
+const uint64_t ALIGN = 64;
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t width, height;
+  int64_t steps;
+  double time;
+  uint32_t codec;
+  uint32_t fields;
+  char reserved[24];
+};
+static_assert(sizeof(Header) == 64, "checkpoint header is 64 bytes");
+
+enum : uint32_t { FLOAT32 = 0, INT32 = 1 };
+
+struct Entry {
+  char name[16];
+  uint32_t type;
+  uint32_t rows, cols;
+  uint32_t reserved;
+  uint64_t offset; // from the start of the file
+  uint64_t stored; // bytes in the file
+  uint64_t raw;    // bytes once decompressed
+  char pad[8];
+};
+static_assert(sizeof(Entry) == 64, "checkpoint field entry is 64 bytes");
+
+template <typename T>
+using HostRows = Kokkos::View<T **, Kokkos::LayoutRight, Kokkos::HostSpace>;
+
+// Row-major host copy of a device grid
+template <typename View> auto toRows(const View &d) {
+  using T = typename View::non_const_value_type;
+  auto mirror = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), d);
+  HostRows<T> rows(
+      Kokkos::view_alloc(Kokkos::WithoutInitializing, "Checkpoint rows"),
+      d.extent(0), d.extent(1));
+  Kokkos::deep_copy(rows, mirror);
+  return rows;
+}
+
+// Row-major host data into a device grid
+template <typename View, typename T>
+void fromRows(const View &d, const HostRows<const T> &rows) {
+  auto mirror = Kokkos::create_mirror_view(d);
+  Kokkos::deep_copy(mirror, rows);
+  Kokkos::deep_copy(d, mirror);
+}
+
+// Whole file, mapped read-only where mmap exists, read otherwise
+class FileData {
+public:
+  explicit FileData(const std::string &path) {
+#ifdef __unix__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        mapped = static_cast<const char *>(p);
+        length = st.st_size;
+      }
+    }
+    ::close(fd);
+    if (mapped)
+      return;
+#endif
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+      return;
+    buffer.resize(file.tellg());
+    file.seekg(0);
+    if (file.read(buffer.data(), buffer.size()))
+      length = buffer.size();
+  }
+  ~FileData() {
+#ifdef __unix__
+    if (mapped)
+      munmap(const_cast<char *>(mapped), length);
+#endif
+  }
+  FileData(const FileData &) = delete;
+  FileData &operator=(const FileData &) = delete;
+
+  const char *data() const { return mapped ? mapped : buffer.data(); }
+  size_t size() const { return length; }
+
+private:
+  const char *mapped = nullptr;
+  std::vector<char> buffer;
+  size_t length = 0;
+};
+
+// The field `name` of the file as a row-major host view: in place when
+// stored raw, decompressed otherwise
+template <typename T>
+bool stage(const FileData &file, const Header &header,
+           const std::vector<Entry> &entries, const char *name, uint32_t type,
+           size_t rows, size_t cols, HostRows<const T> &out,
+           std::string &error) {
+  const Entry *entry = nullptr;
+  for (const Entry &e : entries)
+    if (std::strncmp(e.name, name, sizeof(e.name)) == 0)
+      entry = &e;
+  if (!entry) {
+    error = std::string("missing field ") + name;
+    return false;
+  }
+  const uint64_t raw = uint64_t(rows) * cols * sizeof(T);
+  if (entry->type != type || entry->rows != rows || entry->cols != cols ||
+      entry->raw != raw || entry->offset > file.size() ||
+      entry->stored > file.size() - entry->offset) {
+    error = std::string("bad entry for ") + name;
+    return false;
+  }
+  const char *src = file.data() + entry->offset;
+  Codec codec = Codec(header.codec);
+  if (codec == Codec::None) {
+    if (entry->stored != raw || entry->offset % alignof(T) != 0) {
+      error = std::string("bad entry for ") + name;
+      return false;
+    }
+    out = HostRows<const T>(reinterpret_cast<const T *>(src), rows, cols);
+    return true;
+  }
+  HostRows<T> rowsView(
+      Kokkos::view_alloc(Kokkos::WithoutInitializing, "Checkpoint rows"),
+      rows, cols);
+  if (!decompress(codec, src, entry->stored, rowsView.data(), raw)) {
+    error = std::string("corrupt field ") + name;
+    return false;
+  }
+  out = rowsView;
+  return true;
+}
+
+} // namespace
+
+bool save_checkpoint(const Sim &sim, const std::string &path, Codec codec) {
+  if (!codec_available(codec)) {
+    std::cerr << path << ": " << codec_name(codec) << " not available\n";
+    return false;
+  }
+  Kokkos::Profiling::pushRegion("save_checkpoint");
+  const Mac &mac = sim.mac;
+  struct Source {
+    const char *name;
+    uint32_t type;
+    const void *data;
+    size_t rows, cols;
+  };
+  auto u = toRows(mac.xgrid.d_view);
+  auto v = toRows(mac.ygrid.d_view);
+  auto s = toRows(mac.sgrid.d_view);
+  auto p = toRows(mac.pressure.d_view);
+  auto d = toRows(sim.density.field.d_view);
+  const Source sources[] = {
+      {"u", FLOAT32, u.data(), u.extent(0), u.extent(1)},
+      {"v", FLOAT32, v.data(), v.extent(0), v.extent(1)},
+      {"solid", INT32, s.data(), s.extent(0), s.extent(1)},
+      {"pressure", FLOAT32, p.data(), p.extent(0), p.extent(1)},
+      {"density", FLOAT32, d.data(), d.extent(0), d.extent(1)},
+  };
+  const uint32_t count = sizeof(sources) / sizeof(sources[0]);
+
+  Header header = {};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.width = WIDTH;
+  header.height = HEIGHT;
+  header.steps = sim.steps;
+  header.time = sim.time;
+  header.codec = uint32_t(codec);
+  header.fields = count;
+
+  // Written under a temporary name, so a crash never leaves a truncated
+  // checkpoint behind
+  const std::string tmp = path + ".tmp";
+  std::ofstream file(tmp, std::ios::binary);
+  std::vector<Entry> entries(count);
+  uint64_t offset = sizeof(Header) + count * sizeof(Entry);
+  file.seekp(offset);
+  std::vector<char> packed;
+  static const char zeros[ALIGN] = {};
+  for (uint32_t k = 0; k < count && file; k++) {
+    const Source &src = sources[k];
+    Entry &e = entries[k];
+    std::strncpy(e.name, src.name, sizeof(e.name) - 1);
+    e.type = src.type;
+    e.rows = src.rows;
+    e.cols = src.cols;
+    e.raw = uint64_t(src.rows) * src.cols * 4;
+
+    uint64_t aligned = (offset + ALIGN - 1) / ALIGN * ALIGN;
+    file.write(zeros, aligned - offset);
+    e.offset = aligned;
+    if (codec == Codec::None) {
+      file.write(static_cast<const char *>(src.data), e.raw);
+      e.stored = e.raw;
+    } else {
+      packed.clear();
+      if (!compress(codec, src.data, e.raw, packed)) {
+        file.setstate(std::ios::failbit);
+        break;
+      }
+      file.write(packed.data(), packed.size());
+      e.stored = packed.size();
+    }
+    offset = e.offset + e.stored;
+  }
+  file.seekp(0);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(entries.data()),
+             count * sizeof(Entry));
+  file.close();
+  bool ok = bool(file) && std::rename(tmp.c_str(), path.c_str()) == 0;
+  if (!ok) {
+    std::remove(tmp.c_str());
+    std::cerr << path << ": cannot write checkpoint\n";
+  }
+  Kokkos::Profiling::popRegion();
+  return ok;
+}
+
+bool load_checkpoint(Sim &sim, const std::string &path) {
+  FileData file(path);
+  Header header;
+  std::vector<Entry> entries;
+  std::string error;
+  if (file.size() < sizeof(Header)) {
+    error = "cannot read checkpoint";
+  } else {
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+      error = "not a checkpoint";
+    else if (header.version != VERSION)
+      error = "unsupported checkpoint version " +
+              std::to_string(header.version);
+    else if (header.width != uint32_t(WIDTH) ||
+             header.height != uint32_t(HEIGHT))
+      error = "checkpoint is " + std::to_string(header.width) + "x" +
+              std::to_string(header.height) + ", this build " +
+              std::to_string(WIDTH) + "x" + std::to_string(HEIGHT);
+    else if (!codec_available(Codec(header.codec)))
+      error = std::string(codec_name(Codec(header.codec))) +
+              " not available in this build";
+    else if (header.fields > (file.size() - sizeof(Header)) / sizeof(Entry))
+      error = "truncated checkpoint";
+  }
+  if (!error.empty()) {
+    std::cerr << path << ": " << error << "\n";
+    return false;
+  }
+  entries.resize(header.fields);
+  std::memcpy(entries.data(), file.data() + sizeof(Header),
+              entries.size() * sizeof(Entry));
+
+  // Everything is staged on the host before any grid is touched
+  Mac &mac = sim.mac;
+  HostRows<const float> u, v, p, d;
+  HostRows<const int> s;
+  bool ok =
+      stage(file, header, entries, "u", FLOAT32, mac.xgrid.d_view.extent(0),
+            mac.xgrid.d_view.extent(1), u, error) &&
+      stage(file, header, entries, "v", FLOAT32, mac.ygrid.d_view.extent(0),
+            mac.ygrid.d_view.extent(1), v, error) &&
+      stage(file, header, entries, "solid", INT32, mac.sgrid.d_view.extent(0),
+            mac.sgrid.d_view.extent(1), s, error) &&
+      stage(file, header, entries, "pressure", FLOAT32,
+            mac.pressure.d_view.extent(0), mac.pressure.d_view.extent(1), p,
+            error) &&
+      stage(file, header, entries, "density", FLOAT32,
+            sim.density.field.d_view.extent(0),
+            sim.density.field.d_view.extent(1), d, error);
+  if (!ok) {
+    std::cerr << path << ": " << error << "\n";
+    return false;
+  }
+
+  Kokkos::Profiling::pushRegion("load_checkpoint");
+  fromRows(mac.xgrid.d_view, u);
+  fromRows(mac.ygrid.d_view, v);
+  fromRows(mac.sgrid.d_view, s);
+  fromRows(mac.pressure.d_view, p);
+  fromRows(sim.density.field.d_view, d);
+  Kokkos::fence();
+  Kokkos::Profiling::popRegion();
+  sim.steps = header.steps;
+  sim.time = header.time;
+  return true;
+}
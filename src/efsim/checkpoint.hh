@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "efsim/codec.hh"
+#include "efsim/sim.hh"
+
+// Simulation state on disk: velocities, obstacle mask, pressure (the
+// Jacobi solver's warm start), density, and Sim::steps / Sim::time. Scratch
+// grids are not stored; every step rewrites them before reading.
+//
+// Layout, little-endian: a 64-byte header ("EFCK", version, grid size,
+// steps, time, codec, field count), one 64-byte entry per field (name,
+// element type, rows, cols, offset, stored and raw size), then each
+// field's rows, row-major, each starting on a 64-byte boundary.
+// Uncompressed files are read straight from an mmap of the file.
+//
+// A checkpoint only loads into a build with the same grid size.
+bool save_checkpoint(const Sim &sim, const std::string &path,
+                     Codec codec = Codec::None);
+// False, with the reason on stderr, if the file is unreadable, of another
+// version or grid size, or corrupt. `sim` is unchanged unless every field
+// was read.
+bool load_checkpoint(Sim &sim, const std::string &path);
@@ -0,0 +1,111 @@
+#include "codec.hh"
+
+#include <climits>
+#include <cstring>
+
+#ifdef EFSIM_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef EFSIM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+const char *codec_name(Codec codec) {
+  switch (codec) {
+  case Codec::Lz4:
+    return "lz4";
+  case Codec::Zstd:
+    return "zstd";
+  default:
+    return "none";
+  }
+}
+
+bool parse_codec(const std::string &name, Codec &codec) {
+  for (Codec c : {Codec::None, Codec::Lz4, Codec::Zstd})
+    if (name == codec_name(c)) {
+      codec = c;
+      return true;
+    }
+  return false;
+}
+
+bool codec_available(Codec codec) {
+  switch (codec) {
+  case Codec::None:
+    return true;
+#ifdef EFSIM_HAVE_LZ4
+  case Codec::Lz4:
+    return true;
+#endif
+#ifdef EFSIM_HAVE_ZSTD
+  case Codec::Zstd:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+bool compress(Codec codec, const void *src, size_t size,
+              std::vector<char> &out, int level) {
+  const size_t start = out.size();
+  switch (codec) {
+  case Codec::None:
+    out.resize(start + size);
+    std::memcpy(out.data() + start, src, size);
+    return true;
+#ifdef EFSIM_HAVE_LZ4
+  case Codec::Lz4: {
+    if (size > size_t(LZ4_MAX_INPUT_SIZE))
+      return false;
+    out.resize(start + LZ4_compressBound(int(size)));
+    int n = LZ4_compress_default(static_cast<const char *>(src),
+                                 out.data() + start, int(size),
+                                 int(out.size() - start));
+    out.resize(start + (n > 0 ? n : 0));
+    return n > 0;
+  }
+#endif
+#ifdef EFSIM_HAVE_ZSTD
+  case Codec::Zstd: {
+    out.resize(start + ZSTD_compressBound(size));
+    size_t n = ZSTD_compress(out.data() + start, out.size() - start, src, size,
+                             level ? level : ZSTD_CLEVEL_DEFAULT);
+    bool ok = !ZSTD_isError(n);
+    out.resize(start + (ok ? n : 0));
+    return ok;
+  }
+#endif
+  default:
+    (void)level;
+    return false;
+  }
+}
+
+bool decompress(Codec codec, const void *src, size_t size, void *dst,
+                size_t rawSize) {
+  switch (codec) {
+  case Codec::None:
+    if (size != rawSize)
+      return false;
+    std::memcpy(dst, src, size);
+    return true;
+#ifdef EFSIM_HAVE_LZ4
+  case Codec::Lz4:
+    if (size > INT_MAX || rawSize > INT_MAX)
+      return false;
+    return LZ4_decompress_safe(static_cast<const char *>(src),
+                               static_cast<char *>(dst), int(size),
+                               int(rawSize)) == int(rawSize);
+#endif
+#ifdef EFSIM_HAVE_ZSTD
+  case Codec::Zstd: {
+    size_t n = ZSTD_decompress(dst, rawSize, src, size);
+    return !ZSTD_isError(n) && n == rawSize;
+  }
+#endif
+  default:
+    return false;
+  }
+}
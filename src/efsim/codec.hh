@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Optional lossless compression for the files efsim writes. LZ4 and Zstd
+// are only available when CMake found the libraries (EFSIM_HAVE_LZ4,
+// EFSIM_HAVE_ZSTD); None always is.
+enum class Codec : int { None = 0, Lz4 = 1, Zstd = 2 };
+
+const char *codec_name(Codec codec);
+// "none", "lz4" or "zstd"; false if unknown
+bool parse_codec(const std::string &name, Codec &codec);
+bool codec_available(Codec codec);
+
+// Append `size` bytes at `src`, compressed, to `out`. `level` is Zstd's
+// (0 = its default) and ignored by the others. False if the codec is not
+// available or fails.
+bool compress(Codec codec, const void *src, size_t size,
+              std::vector<char> &out, int level = 0);
+// Decompress exactly `rawSize` bytes into `dst`; false on corrupt input
+bool decompress(Codec codec, const void *src, size_t size, void *dst,
+                size_t rawSize);
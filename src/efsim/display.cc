@@ -0,0 +1,182 @@
+#include "display.hh"
+
+#include "consts.hh"
+#include "efsim/utils.hh"
+
+void quantize(const Kokkos::View<float **> &src,
+              const Kokkos::View<unsigned char *> &dst, DisplayFormat format,
+              float scale, float offset, bool saturate) {
+  auto s = src;
+  const int h = src.extent(0);
+
+  switch (format) {
+  case DisplayFormat::Float32: {
+    float *out = reinterpret_cast<float *>(dst.data());
+    Kokkos::parallel_for(
+        "Quantize F32", MDPOL(h, int(src.extent(1))),
+        KOKKOS_LAMBDA(int j, int i) {
+          float v = s(j, i) * scale + offset;
+          out[i * h + j] = saturate ? Kokkos::clamp(v, 0.0f, 1.0f) : v;
+        });
+    break;
+  }
+  case DisplayFormat::Half: {
+    uint16_t *out = reinterpret_cast<uint16_t *>(dst.data());
+    Kokkos::parallel_for(
+        "Quantize F16", MDPOL(h, int(src.extent(1))),
+        KOKKOS_LAMBDA(int j, int i) {
+          float v = s(j, i) * scale + offset;
+          if (saturate)
+            v = Kokkos::clamp(v, 0.0f, 1.0f);
+          out[i * h + j] = float_to_half(v);
+        });
+    break;
+  }
+  case DisplayFormat::UNorm8: {
+    unsigned char *out = dst.data();
+    Kokkos::parallel_for(
+        "Quantize U8", MDPOL(h, int(src.extent(1))),
+        KOKKOS_LAMBDA(int j, int i) {
+          float v = Kokkos::clamp(s(j, i) * scale + offset, 0.0f, 1.0f);
+          out[i * h + j] = (unsigned char)(v * 255.0f + 0.5f);
+        });
+    break;
+  }
+  }
+
+  Kokkos::DefaultExecutionSpace().fence();
+}
+
+void downsample(const Kokkos::View<float **> &src, int factor,
+                const Kokkos::View<float **> &dst) {
+  auto s = src;
+  auto d = dst;
+  const float norm = 1.0f / (factor * factor);
+  Kokkos::parallel_for(
+      "Downsample", MDPOL(int(dst.extent(0)), int(dst.extent(1))),
+      KOKKOS_LAMBDA(int j, int i) {
+        float sum = 0.0f;
+        for (int jj = j * factor; jj < (j + 1) * factor; jj++)
+          for (int ii = i * factor; ii < (i + 1) * factor; ii++)
+            sum += s(jj, ii);
+        d(j, i) = sum * norm;
+      });
+  Kokkos::DefaultExecutionSpace().fence();
+}
+
+int lod_factor(int width, int height, int viewWidth, int viewHeight) {
+  int factor = 1;
+  while (factor < 16 && width / (2 * factor) >= viewWidth &&
+         height / (2 * factor) >= viewHeight)
+    factor *= 2;
+  return factor;
+}
+
+FieldRange field_range(const Kokkos::View<float **> &src) {
+  auto s = src;
+  using MinMax = Kokkos::MinMax<float>;
+  MinMax::value_type mm;
+  Kokkos::parallel_reduce(
+      "Field MinMax", MDPOL(int(src.extent(0)), int(src.extent(1))),
+      KOKKOS_LAMBDA(int j, int i, MinMax::value_type &acc) {
+        float v = s(j, i);
+        if (v < acc.min_val)
+          acc.min_val = v;
+        if (v > acc.max_val)
+          acc.max_val = v;
+      },
+      MinMax(mm));
+  return {mm.min_val, mm.max_val};
+}
+
+FieldRange clipped_range(const Kokkos::View<float **> &src, FieldRange full,
+                         float clip) {
+  const int BINS = 1024;
+  if (clip <= 0.0f || full.hi <= full.lo)
+    return full;
+
+  auto s = src;
+  Kokkos::View<int *> hist("Histogram", BINS);
+  float lo = full.lo;
+  float binScale = BINS / (full.hi - full.lo);
+  Kokkos::parallel_for(
+      "Field Histogram", MDPOL(int(src.extent(0)), int(src.extent(1))),
+      KOKKOS_LAMBDA(int j, int i) {
+        int b = int((s(j, i) - lo) * binScale);
+        Kokkos::atomic_increment(&hist(Kokkos::clamp(b, 0, BINS - 1)));
+      });
+  auto h = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), hist);
+
+  // Walk the (small) cumulative histogram on the host
+  long total = long(src.extent(0)) * src.extent(1);
+  long cut = long(clip * total);
+  long sum = 0;
+  int bLo = 0;
+  while (bLo < BINS - 1 && sum + h(bLo) <= cut)
+    sum += h(bLo++);
+  sum = 0;
+  int bHi = BINS - 1;
+  while (bHi > bLo && sum + h(bHi) <= cut)
+    sum += h(bHi--);
+
+  float binWidth = (full.hi - full.lo) / BINS;
+  return {full.lo + bLo * binWidth, full.lo + (bHi + 1) * binWidth};
+}
+
+void normalize(const Kokkos::View<float **> &src,
+               const Kokkos::View<unsigned char *> &dst, DisplayFormat format,
+               FieldRange range) {
+  float extent = range.hi - range.lo;
+  if (extent < 1e-6f)
+    extent = 1.0f; // avoid divide by zero
+  quantize(src, dst, format, 1.0f / extent, -range.lo / extent, true);
+}
+
+void derived_field(Mac &mac, Derived field, const Kokkos::View<float **> &out) {
+  auto u = mac.xgrid.d_view; // (HEIGHT, WIDTH+1)
+  auto v = mac.ygrid.d_view; // (HEIGHT+1, WIDTH)
+  auto s = mac.sgrid.d_view; // (HEIGHT+2, WIDTH+2)
+  auto o = out;
+
+  Kokkos::parallel_for(
+      "Derived Field", MDPOL(HEIGHT, WIDTH), KOKKOS_LAMBDA(int j, int i) {
+        if (j == 0 || i == 0 || j == HEIGHT - 1 || i == WIDTH - 1 ||
+            s(j + 1, i + 1) == 0) {
+          o(j, i) = 0.0f;
+          return;
+        }
+
+        // Cell-centred velocities of the 4-neighbourhood
+        auto uc = [&](int jj, int ii) {
+          return 0.5f * (u(jj, ii) + u(jj, ii + 1));
+        };
+        auto vc = [&](int jj, int ii) {
+          return 0.5f * (v(jj, ii) + v(jj + 1, ii));
+        };
+
+        // Face differences are exact at the centre, cross terms are central
+        float dudx = u(j, i + 1) - u(j, i);
+        float dvdy = v(j + 1, i) - v(j, i);
+        float dudy = 0.5f * (uc(j + 1, i) - uc(j - 1, i));
+        float dvdx = 0.5f * (vc(j, i + 1) - vc(j, i - 1));
+
+        float r = 0.0f;
+        switch (field) {
+        case Derived::Vorticity:
+          r = dvdx - dudy;
+          break;
+        case Derived::Speed:
+          r = Kokkos::sqrt(uc(j, i) * uc(j, i) + vc(j, i) * vc(j, i));
+          break;
+        case Derived::Divergence:
+          r = dudx + dvdy;
+          break;
+        case Derived::QCriterion:
+          r = -0.5f * (dudx * dudx + dvdy * dvdy) - dudy * dvdx;
+          break;
+        }
+        o(j, i) = r;
+      });
+
+  Kokkos::DefaultExecutionSpace().fence();
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <Kokkos_BitManipulation.hpp>
+#include <Kokkos_Core.hpp>
+#include <cstddef>
+#include <cstdint>
+
+#include "efsim/mac.hh"
+
+// Texel formats for fields that are only read back for display
+enum class DisplayFormat : int {
+  Float32 = 0, // GL_R32F
+  Half = 1,    // GL_R16F, IEEE binary16
+  UNorm8 = 2,  // GL_R8, [0,1] mapped to 0..255
+};
+
+KOKKOS_INLINE_FUNCTION size_t texel_bytes(DisplayFormat format) {
+  return format == DisplayFormat::Float32 ? 4
+         : format == DisplayFormat::Half  ? 2
+                                          : 1;
+}
+
+// float -> binary16 bits, round to nearest even. Kokkos::half_t is a plain
+// float on host backends, so the conversion is done by hand.
+KOKKOS_INLINE_FUNCTION uint16_t float_to_half(float f) {
+  uint32_t x = Kokkos::bit_cast<uint32_t>(f);
+  uint32_t sign = (x >> 16) & 0x8000u;
+  int e = int((x >> 23) & 0xff);
+  uint32_t mant = x & 0x7fffffu;
+
+  if (e == 0xff) // inf / nan
+    return sign | 0x7c00u | (mant ? 0x200u : 0u);
+
+  int exp = e - 127 + 15;
+  if (exp >= 31) // overflow
+    return sign | 0x7c00u;
+
+  if (exp <= 0) { // subnormal or zero
+    if (exp < -10)
+      return sign;
+    mant |= 0x800000u;
+    int shift = 14 - exp;
+    uint32_t h = mant >> shift;
+    uint32_t rem = mant & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (h & 1)))
+      h++;
+    return sign | h;
+  }
+
+  uint32_t h = sign | (uint32_t(exp) << 10) | (mant >> 13);
+  uint32_t rem = mant & 0x1fffu;
+  if (rem > 0x1000u || (rem == 0x1000u && (h & 1)))
+    h++; // a carry into the exponent is still correctly rounded
+  return h;
+}
+
+// Pack a (HEIGHT, WIDTH) field into `dst` as `format` texels, storing
+// value * scale + offset. Texture rows run along x (texel row i, column j),
+// like the obstacle texture, independent of the view's layout. UNorm8
+// always clamps to [0,1], the float formats only when `saturate` is set.
+void quantize(const Kokkos::View<float **> &src,
+              const Kokkos::View<unsigned char *> &dst, DisplayFormat format,
+              float scale = 1.0f, float offset = 0.0f, bool saturate = false);
+
+// Box-filter `src` by `factor` in both directions into `dst`, which must be
+// (src.extent(0) / factor, src.extent(1) / factor)
+void downsample(const Kokkos::View<float **> &src, int factor,
+                const Kokkos::View<float **> &dst);
+
+// Largest power-of-two reduction (up to 16) of a (height, width) grid that
+// still covers a viewWidth x viewHeight viewport at one texel per pixel
+int lod_factor(int width, int height, int viewWidth, int viewHeight);
+
+struct FieldRange {
+  float lo, hi;
+};
+
+// Min/max of the field (parallel_reduce)
+FieldRange field_range(const Kokkos::View<float **> &src);
+
+// Range between the `clip` and 1 - `clip` quantiles of the field, read off
+// a device histogram over `full`. Keeps a few extreme cells near walls from
+// washing out the rest of the display.
+FieldRange clipped_range(const Kokkos::View<float **> &src, FieldRange full,
+                         float clip);
+
+// Map `range` to [0,1] and pack, in a single kernel
+void normalize(const Kokkos::View<float **> &src,
+               const Kokkos::View<unsigned char *> &dst, DisplayFormat format,
+               FieldRange range);
+
+// Flow quantities derived from the MAC velocities, shown via uMode
+enum class Derived : int {
+  Vorticity = 0,  // dv/dx - du/dy
+  Speed = 1,      // |u|
+  Divergence = 2, // residual after projection
+  QCriterion = 3, // (|Omega|^2 - |S|^2) / 2
+};
+
+// True if zero should sit in the middle of the colormap
+inline bool is_signed(Derived field) { return field != Derived::Speed; }
+
+// Cell-centred (HEIGHT, WIDTH) derived field, zero in solid and edge cells
+void derived_field(Mac &mac, Derived field, const Kokkos::View<float **> &out);
@@ -62,7 +62,7 @@ void clear_divergence_opti(Mac &mac, int iters, bool OVERRELAXATION) {
             v(j, i) += d * sD / curs;
             v(j + 1, i) -= d * sU / curs;
           });
-      Kokkos::fence();
+      Kokkos::DefaultExecutionSpace().fence();
     }
   }
 }
@@ -85,7 +85,7 @@ void solve_pressure(Mac &mac, int iters) {
           pressure_tmp.d_view(j, i) =
               0.25f * (pL + pR + pD + pU - divergence(j, i));
         });
-    Kokkos::fence();
+    Kokkos::DefaultExecutionSpace().fence();
 
     // Swap the **dual view device data**
     std::swap(pressure.d_view, pressure_tmp.d_view);
@@ -113,7 +113,7 @@ void subtract_pressure_gradient(Mac &mac) {
       Kokkos::MDRangePolicy<Kokkos::Rank<2>>({1, 1}, {HEIGHT, WIDTH - 1}),
       KOKKOS_LAMBDA(int j, int i) { v(j, i) -= p(j, i) - p(j - 1, i); });
 
-  Kokkos::fence();
+  Kokkos::DefaultExecutionSpace().fence();
 }
 
 void compute_divergence(Mac &mac) {
@@ -130,5 +130,5 @@ void compute_divergence(Mac &mac) {
         divergence(j, i) = du + dv;       // Δx = Δy = 1
       });
 
-  Kokkos::fence();
+  Kokkos::DefaultExecutionSpace().fence();
 }
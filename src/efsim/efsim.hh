@@ -0,0 +1,22 @@
+#pragma once
+
+// Public header of the efsim library: the MAC grid, transported scalars
+// and the projection / advection kernels behind Sim::step. Pulls in
+// nothing from the GUI; only Kokkos and the grid size in consts.hh.
+#include "consts.hh"
+#include "efsim/advect.hh"
+#include "efsim/brush.hh"
+#include "efsim/checkpoint.hh"
+#include "efsim/codec.hh"
+#include "efsim/div.hh"
+#include "efsim/field_writer.hh"
+#include "efsim/mac.hh"
+#include "efsim/params.hh"
+#include "efsim/perf_counters.hh"
+#include "efsim/profile.hh"
+#include "efsim/roofline.hh"
+#include "efsim/scalar.hh"
+#include "efsim/sim.hh"
+#include "efsim/trace.hh"
+#include "efsim/video.hh"
+#include "efsim/xdmf.hh"
@@ -0,0 +1,285 @@
+#include "field_writer.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+#include "consts.hh"
+#include "efsim/trace.hh"
+
+namespace {
+
+const uint32_t VERSION = 1;
+const OutputField FIELDS[] = {OUTPUT_DENSITY, OUTPUT_U, OUTPUT_V,
+                              OUTPUT_PRESSURE};
+
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t width, height;
+  uint32_t fields; // OutputField mask
+  uint32_t codec;
+  uint32_t quantized;
+  uint32_t reserved;
+};
+
+struct FrameHeader {
+  char magic[4];
+  uint32_t fields;
+  int64_t step;
+  double time;
+};
+
+struct FieldHeader {
+  uint32_t id; // OutputField
+  uint32_t rows, cols;
+  uint32_t encoding; // 0 float32, 1 uint16 over [lo, hi]
+  float lo, hi;
+  uint64_t stored, raw;
+};
+
+// The device grid holding `field`
+Kokkos::View<float **> grid(const Sim &sim, OutputField field) {
+  switch (field) {
+  case OUTPUT_U:
+    return sim.mac.xgrid.d_view;
+  case OUTPUT_V:
+    return sim.mac.ygrid.d_view;
+  case OUTPUT_PRESSURE:
+    return sim.mac.pressure.d_view;
+  default:
+    return sim.density.field.d_view;
+  }
+}
+
+// Rows and columns of `field`'s grid
+void shape(OutputField field, int &rows, int &cols) {
+  rows = field == OUTPUT_V ? HEIGHT + 1 : HEIGHT;
+  cols = field == OUTPUT_U ? WIDTH + 1 : WIDTH;
+}
+
+} // namespace
+
+const char *output_field_name(OutputField field) {
+  switch (field) {
+  case OUTPUT_U:
+    return "u";
+  case OUTPUT_V:
+    return "v";
+  case OUTPUT_PRESSURE:
+    return "pressure";
+  default:
+    return "density";
+  }
+}
+
+bool parse_output_fields(const std::string &names, unsigned &mask) {
+  unsigned result = 0;
+  size_t start = 0;
+  while (start <= names.size()) {
+    size_t end = std::min(names.find(',', start), names.size());
+    std::string name = names.substr(start, end - start);
+    auto it = std::find_if(std::begin(FIELDS), std::end(FIELDS),
+                           [&](OutputField f) {
+                             return name == output_field_name(f);
+                           });
+    if (it == std::end(FIELDS))
+      return false;
+    result |= *it;
+    start = end + 1;
+  }
+  mask = result;
+  return true;
+}
+
+FieldWriter::FieldWriter(const std::string &path, const OutputOptions &options)
+    : options(options) {
+  file = std::fopen(path.c_str(), "wb");
+  if (!file || !codec_available(options.codec)) {
+    failed = true;
+    return;
+  }
+  // Large buffered appends; the writer thread is the only user
+  std::setvbuf(file, nullptr, _IOFBF, 1 << 22);
+
+  FileHeader header = {};
+  std::memcpy(header.magic, "EFS1", 4);
+  header.version = VERSION;
+  header.width = WIDTH;
+  header.height = HEIGHT;
+  header.fields = options.fields;
+  header.codec = uint32_t(options.codec);
+  header.quantized = options.quantize;
+  std::fwrite(&header, sizeof(header), 1, file);
+
+  pool.resize(std::max(1, options.queueDepth));
+  for (Frame &frame : pool) {
+    for (OutputField f : FIELDS)
+      if (options.fields & f) {
+        int rows, cols;
+        shape(f, rows, cols);
+        frame.grids.emplace_back(
+            f, HostGrid(Kokkos::view_alloc(Kokkos::WithoutInitializing,
+                                           output_field_name(f)),
+                        rows, cols));
+      }
+    idle.push_back(&frame);
+  }
+  thread = std::thread(&FieldWriter::run, this);
+}
+
+FieldWriter::~FieldWriter() {
+  if (thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+  }
+  if (file)
+    std::fclose(file);
+}
+
+void FieldWriter::snapshot(const Sim &sim) {
+  if (failed)
+    return;
+  Frame *frame;
+  {
+    Kokkos::Timer timer;
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return !idle.empty(); });
+    frame = idle.back();
+    idle.pop_back();
+    blocked += timer.seconds();
+  }
+
+  Kokkos::Profiling::pushRegion("FieldWriter::snapshot");
+  frame->step = sim.steps;
+  frame->time = sim.time;
+  for (auto &g : frame->grids)
+    Kokkos::deep_copy(g.second, grid(sim, g.first));
+  Kokkos::fence("FieldWriter::snapshot");
+  Kokkos::Profiling::popRegion();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(frame);
+  }
+  cv.notify_all();
+}
+
+void FieldWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [&] { return pending.empty() && busy == 0; });
+  if (file && std::fflush(file) != 0)
+    failed = true;
+}
+
+void FieldWriter::run() {
+  Trace::nameThread("writer");
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    cv.wait(lock, [&] { return stopping || !pending.empty(); });
+    if (pending.empty())
+      break; // stopping, and everything is written
+    Frame *frame = pending.front();
+    pending.pop_front();
+    busy++;
+    lock.unlock();
+    write(*frame);
+    lock.lock();
+    busy--;
+    idle.push_back(frame);
+    cv.notify_all();
+  }
+}
+
+void FieldWriter::write(const Frame &frame) {
+  TraceScope scope("FieldWriter::write");
+  if (failed)
+    return; // frames queued behind a failed one are dropped
+  FrameHeader header = {};
+  std::memcpy(header.magic, "FRAM", 4);
+  header.fields = frame.grids.size();
+  header.step = frame.step;
+  header.time = frame.time;
+  // The first failed write ends the frame; it is counted only if every
+  // write succeeded
+  if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+    failed = true;
+    return;
+  }
+  uint64_t rawBytes = 0, fileBytes = sizeof(header);
+
+  for (const auto &g : frame.grids) {
+    const HostGrid &h = g.second;
+    const int nr = h.extent(0), nc = h.extent(1);
+    const size_t n = size_t(nr) * nc;
+
+    // Row-major, as the file stores it
+    const float *values = h.data();
+    if (!std::is_same<HostGrid::array_layout, Kokkos::LayoutRight>::value) {
+      ordered.resize(n);
+      for (int j = 0; j < nr; j++)
+        for (int i = 0; i < nc; i++)
+          ordered[size_t(j) * nc + i] = h(j, i);
+      values = ordered.data();
+    }
+
+    FieldHeader field = {};
+    field.id = g.first;
+    field.rows = nr;
+    field.cols = nc;
+    const void *data = values;
+    size_t size = n * sizeof(float);
+    if (options.quantize) {
+      // NaNs and infinities are kept out of the range and stored as 0
+      float lo = INFINITY, hi = -INFINITY;
+      for (size_t k = 0; k < n; k++)
+        if (std::isfinite(values[k])) {
+          lo = std::min(lo, values[k]);
+          hi = std::max(hi, values[k]);
+        }
+      if (lo > hi)
+        lo = hi = 0.0f;
+      const float scale = hi > lo ? 65535.0f / (hi - lo) : 0.0f;
+      quantized.resize(n);
+      for (size_t k = 0; k < n; k++)
+        quantized[k] = std::isfinite(values[k])
+                           ? uint16_t((values[k] - lo) * scale + 0.5f)
+                           : 0;
+      field.encoding = 1;
+      field.lo = lo;
+      field.hi = hi;
+      data = quantized.data();
+      size = n * sizeof(uint16_t);
+    }
+    field.raw = size;
+
+    packed.clear();
+    if (options.codec == Codec::None) {
+      field.stored = size;
+    } else {
+      if (!compress(options.codec, data, size, packed, options.level)) {
+        failed = true;
+        return;
+      }
+      data = packed.data();
+      field.stored = packed.size();
+    }
+    if (std::fwrite(&field, sizeof(field), 1, file) != 1 ||
+        std::fwrite(data, 1, field.stored, file) != field.stored) {
+      failed = true;
+      return;
+    }
+    rawBytes += size;
+    fileBytes += sizeof(field) + field.stored;
+  }
+
+  bytesRaw += rawBytes;
+  bytesFile += fileBytes;
+  written++;
+}
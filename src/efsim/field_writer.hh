@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Kokkos_Core.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "efsim/codec.hh"
+#include "efsim/sim.hh"
+
+// Fields a FieldWriter records, as a bit mask
+enum OutputField : unsigned {
+  OUTPUT_DENSITY = 1,
+  OUTPUT_U = 2,
+  OUTPUT_V = 4,
+  OUTPUT_PRESSURE = 8,
+};
+
+const char *output_field_name(OutputField field);
+// Comma-separated names ("density,u,v,pressure"); false if one is unknown
+bool parse_output_fields(const std::string &names, unsigned &mask);
+
+struct OutputOptions {
+  unsigned fields = OUTPUT_DENSITY;
+  Codec codec = Codec::None;
+  int level = 0;         // Zstd level, 0 = default
+  bool quantize = false; // lossy: 16 bits per value over the frame's range
+  int queueDepth = 4;    // frames in flight before snapshot() blocks
+};
+
+// Time series of fields written by a background thread. snapshot() copies
+// the requested fields device -> pinned host buffer from a fixed pool and
+// queues them; the writer thread reorders them row-major, optionally
+// quantizes and compresses, and appends one chunk per frame. When every
+// buffer is queued, snapshot() waits for the writer (back-pressure), so
+// memory stays bounded and a slow disk shows up as blocked time.
+//
+// File: "EFS1", version, width, height, field mask, codec, quantize flag,
+// then per frame a chunk: "FRAM", field count, step, time, and per field
+// its id, rows, cols, encoding (0 float32, 1 uint16), range, stored and
+// raw size, and data. Row-major, little-endian.
+//
+// snapshot() and flush() are for one thread, the one running the solver.
+// Destroy the writer before Kokkos::finalize.
+class FieldWriter {
+public:
+  FieldWriter(const std::string &path, const OutputOptions &options);
+  ~FieldWriter(); // writes what is queued
+  FieldWriter(const FieldWriter &) = delete;
+  FieldWriter &operator=(const FieldWriter &) = delete;
+
+  // False if the file could not be opened or a write failed
+  bool ok() const { return !failed.load(); }
+
+  void snapshot(const Sim &sim);
+  // Wait until every queued frame is written
+  void flush();
+
+  // Frames written completely, with their field bytes as encoded
+  // (quantized or not) and as stored in the file
+  long frames() const { return written.load(); }
+  uint64_t rawBytes() const { return bytesRaw.load(); }
+  uint64_t fileBytes() const { return bytesFile.load(); }
+  // Time snapshot() spent waiting for a free buffer
+  double blockedSeconds() const { return blocked; }
+
+  // Same layout as the device grids, so the copy needs no reordering
+  using HostGrid =
+      Kokkos::View<float **, Kokkos::DefaultExecutionSpace::array_layout,
+                   Kokkos::SharedHostPinnedSpace>;
+
+private:
+  struct Frame {
+    long step = 0;
+    double time = 0.0;
+    std::vector<std::pair<OutputField, HostGrid>> grids;
+  };
+
+  void run();
+  void write(const Frame &frame);
+
+  OutputOptions options;
+  std::FILE *file = nullptr;
+  std::vector<Frame> pool;
+  std::vector<Frame *> idle;   // buffers snapshot() may fill
+  std::deque<Frame *> pending; // filled, not yet written
+  int busy = 0;                // frames the writer is encoding
+  bool stopping = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread thread;
+
+  std::atomic<bool> failed{false};
+  std::atomic<long> written{0};
+  std::atomic<uint64_t> bytesRaw{0};
+  std::atomic<uint64_t> bytesFile{0};
+  double blocked = 0.0;
+
+  // Writer thread scratch, reused across frames
+  std::vector<float> ordered;
+  std::vector<uint16_t> quantized;
+  std::vector<char> packed;
+};
@@ -0,0 +1,63 @@
+#include "lic.hh"
+
+#include <Kokkos_Random.hpp>
+
+#include "consts.hh"
+#include "efsim/streamlines.hh"
+#include "efsim/utils.hh"
+
+void lic_noise(const Kokkos::View<float **> &noise, unsigned seed) {
+  Kokkos::Random_XorShift64_Pool<> pool(seed);
+  Kokkos::fill_random(noise, pool, 1.0f);
+  Kokkos::DefaultExecutionSpace().fence();
+}
+
+// Midpoint step of one cell along the normalized velocity (dir = +-1)
+KOKKOS_INLINE_FUNCTION Kokkos::pair<float, float>
+unit_step(const Mac &mac, float x, float y, float dir) {
+  auto unit = [&](float px, float py) {
+    auto v = mac.interpolateDevice(px, py);
+    float n = Kokkos::sqrt(v.first * v.first + v.second * v.second);
+    if (n < 1e-12f)
+      return Kokkos::pair<float, float>(0.0f, 0.0f);
+    return Kokkos::pair<float, float>(dir * v.first / n, dir * v.second / n);
+  };
+  auto k1 = unit(x, y);
+  auto k2 = unit(x + 0.5f * k1.first, y + 0.5f * k1.second);
+  return {x + k2.first, y + k2.second};
+}
+
+void lic(Mac &mac, const Kokkos::View<float **> &noise, int length,
+         const Kokkos::View<float **> &out) {
+  auto s = mac.sgrid.d_view;
+  auto n = noise;
+  auto o = out;
+
+  Kokkos::parallel_for(
+      "LIC", MDPOL(HEIGHT, WIDTH), KOKKOS_LAMBDA(int j, int i) {
+        if (s(j + 1, i + 1) == 0) {
+          o(j, i) = 0.0f;
+          return;
+        }
+
+        float sum = n(j, i);
+        int count = 1;
+        for (float dir = -1.0f; dir <= 1.0f; dir += 2.0f) {
+          float x = i + 0.5f;
+          float y = j + 0.5f;
+          for (int k = 0; k < length; k++) {
+            auto next = unit_step(mac, x, y, dir);
+            if (!in_fluid(s, next.first, next.second) ||
+                (next.first == x && next.second == y))
+              break;
+            x = next.first;
+            y = next.second;
+            sum += n(int(y), int(x));
+            count++;
+          }
+        }
+        o(j, i) = sum / count;
+      });
+
+  Kokkos::DefaultExecutionSpace().fence();
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <Kokkos_Core.hpp>
+
+#include "efsim/mac.hh"
+
+// White noise input for lic(), one value in [0,1) per cell
+void lic_noise(const Kokkos::View<float **> &noise, unsigned seed = 1234);
+
+// Line integral convolution of `noise` along the MAC velocity field: each
+// cell averages the noise over the streamline through its centre,
+// `length` cells upstream and downstream. One thread per cell, midpoint
+// steps of one cell on the normalized velocity. Solid cells are zero.
+void lic(Mac &mac, const Kokkos::View<float **> &noise, int length,
+         const Kokkos::View<float **> &out);
@@ -1,6 +1,5 @@
 #include "mac.hh"
 #include "consts.hh"
-#include "line_segment.hh"
 
 #include <Kokkos_Core.hpp>
 #include <Kokkos_Macros.hpp>
@@ -8,7 +7,7 @@
 #include "consts.hh"
 #include "efsim/utils.hh"
 
-Mac::Mac()
+Mac::Mac(Scenario scenario)
     : sgrid("S grid", HEIGHT + 2, WIDTH + 2),
       xgrid("X grid", HEIGHT, WIDTH + 1), ygrid("Y grid", HEIGHT + 1, WIDTH),
       xtmp("Scalar xtmp", HEIGHT, WIDTH + 1),
@@ -16,24 +15,29 @@ Mac::Mac()
       pressure("Pressure", HEIGHT, WIDTH),
       pressure_tmp("PRessure tmp", HEIGHT, WIDTH) {
 
-  init();
+  init(scenario);
 }
 
-void Mac::init() {
+void Mac::init(Scenario scenario) {
   auto x = xgrid.d_view;
   auto y = ygrid.d_view;
   auto s = sgrid.d_view;
   int ci = WIDTH / 2 - 5;
   int cj = HEIGHT / 2 + 1;
+  const Scenario shape = scenario;
 
   Kokkos::parallel_for(
       "Setup S grid with shape", MDPOL(HEIGHT + 2, WIDTH + 2),
       KOKKOS_LAMBDA(const int j, const int i) {
         if (j <= 1 || j >= HEIGHT || i == 0 || i == WIDTH + 1) {
           s(j, i) = 0; // domain boundary
+        } else if (shape == Scenario::Cylinder) {
+          // 300 cells upstream of the centre at 1024, scaled with the grid
+          s(j, i) = CylinderShape(j, i + 300 * HEIGHT / 1024, WIDTH, HEIGHT);
+        } else if (shape == Scenario::Airfoil) {
+          s(j, i) = AirfoilShape(i - 1, j - 1, WIDTH, HEIGHT);
         } else {
-          
-          s(j, i) = CylinderShape(j, i + 300, WIDTH, HEIGHT);
+          s(j, i) = 1;
         }
       });
 
@@ -48,6 +52,7 @@ void Mac::init() {
 }
 
 void Mac::sync_host() {
+  Kokkos::Profiling::pushRegion("Mac::sync_host");
   xgrid.modify_device();
   ygrid.modify_device();
   sgrid.modify_device();
@@ -58,19 +63,45 @@ void Mac::sync_host() {
   sgrid.sync_host();
   pressure.sync_host();
   div.sync_host();
+  Kokkos::Profiling::popRegion();
 }
 
 void Mac::toggleWall(int i, int j) {
-  sgrid.modify_host();
-  xgrid.modify_host();
-  ygrid.modify_host();
-  sgrid.h_view(j + 1, i + 1) = !sgrid.h_view(j + 1, i + 1);
-  xgrid.h_view(j, i) = 0;
-  xgrid.h_view(j, i + 1) = 0;
-  ygrid.h_view(j, i) = 0;
-  ygrid.h_view(j + 1, i) = 0;
-  sgrid.sync_device();
-  xgrid.sync_device();
-  ygrid.sync_device();
-  Kokkos::fence();
+  auto s = sgrid.d_view;
+  auto x = xgrid.d_view;
+  auto y = ygrid.d_view;
+  Kokkos::parallel_for(
+      "Toggle Wall", Kokkos::RangePolicy<>(0, 1), KOKKOS_LAMBDA(int) {
+        s(j + 1, i + 1) = !s(j + 1, i + 1);
+        x(j, i) = 0;
+        x(j, i + 1) = 0;
+        y(j, i) = 0;
+        y(j + 1, i) = 0;
+      });
+  Kokkos::DefaultExecutionSpace().fence();
+}
+
+void Mac::paint(const Brush &brush) {
+  int i0, j0, i1, j1;
+  brush.bounds(i0, j0, i1, j1);
+  if (i0 > i1 || j0 > j1)
+    return;
+
+  auto s = sgrid.d_view;
+  auto x = xgrid.d_view;
+  auto y = ygrid.d_view;
+  const Brush b = brush;
+  Kokkos::parallel_for(
+      "Paint Brush",
+      Kokkos::MDRangePolicy<Kokkos::Rank<2>>({j0, i0}, {j1 + 1, i1 + 1}),
+      KOKKOS_LAMBDA(const int j, const int i) {
+        if (!b.covers(i, j))
+          return;
+        s(j + 1, i + 1) = b.value;
+        x(j, i) = 0;
+        x(j, i + 1) = 0;
+        y(j, i) = 0;
+        y(j + 1, i) = 0;
+      });
+  Kokkos::DefaultExecutionSpace().fence();
 }
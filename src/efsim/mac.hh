@@ -5,9 +5,12 @@
 #include <Kokkos_Macros.hpp>
 
 #include "consts.hh"
+#include "efsim/brush.hh"
+#include "efsim/params.hh"
+
 class Mac {
 public:
-  Mac();
+  Mac(Scenario scenario = Scenario::Cylinder);
 
   Kokkos::DualView<float **> xgrid;
   Kokkos::DualView<float **> ygrid;
@@ -20,12 +23,12 @@ public:
                                            //
 
   // UI
-  void drawInterp(float i, float j, int r, int g, int b, float factor);
-  void drawRect(int i, int j, int r, int g, int b);
   void toggleWall(int i, int j);
+  // Rasterize a brush stroke on device in one kernel: covered cells take
+  // the brush's value and their faces are zeroed
+  void paint(const Brush &brush);
 
-  void drawLine(float x1, float y1, float x2, float y2, int r, int g, int b);
-  void init();
+  void init(Scenario scenario = Scenario::Cylinder);
   void sync_host();
 
 KOKKOS_INLINE_FUNCTION
@@ -0,0 +1,34 @@
+#include "params.hh"
+
+const char *scenario_name(Scenario scenario) {
+  switch (scenario) {
+  case Scenario::Airfoil:
+    return "airfoil";
+  case Scenario::Empty:
+    return "empty";
+  default:
+    return "cylinder";
+  }
+}
+
+const char *solver_name(Solver solver) {
+  return solver == Solver::RedBlack ? "rbgs" : "jacobi";
+}
+
+bool parse_solver(const std::string &name, Solver &solver) {
+  for (Solver s : {Solver::Jacobi, Solver::RedBlack})
+    if (name == solver_name(s)) {
+      solver = s;
+      return true;
+    }
+  return false;
+}
+
+bool parse_scenario(const std::string &name, Scenario &scenario) {
+  for (Scenario s : {Scenario::Cylinder, Scenario::Airfoil, Scenario::Empty})
+    if (name == scenario_name(s)) {
+      scenario = s;
+      return true;
+    }
+  return false;
+}
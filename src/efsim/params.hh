@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+// Obstacle the wind tunnel starts with
+enum class Scenario : int { Cylinder = 0, Airfoil = 1, Empty = 2 };
+
+const char *scenario_name(Scenario scenario);
+// "cylinder", "airfoil" or "empty"; false if unknown
+bool parse_scenario(const std::string &name, Scenario &scenario);
+
+// Incompressibility solve of Sim::step: Jacobi pressure iterations plus a
+// gradient subtraction, or red-black Gauss-Seidel applied to the
+// velocities directly (clear_divergence_opti, over-relaxed if
+// OVERRELAXATION is set in consts.hh). The latter has no pressure field:
+// Mac::pressure reads zero while it is in use.
+enum class Solver : int { Jacobi = 0, RedBlack = 1 };
+
+const char *solver_name(Solver solver);
+// "jacobi" or "rbgs"; false if unknown
+bool parse_solver(const std::string &name, Solver &solver);
+
+// Solver parameters of one Sim::step. The GUI's ControlPanel extends this
+// with display settings; headless runs fill it from the command line.
+struct SimParams {
+  float velocity = 3.0f; // inflow velocity
+  float dt = 0.2f;       // density advection time step
+  int iters = 40;        // pressure iterations
+  Solver solver = Solver::Jacobi;
+  float inflowDensity = 0.5;
+  float gravity = 0.0f;
+  bool vofAdvection = false;
+};
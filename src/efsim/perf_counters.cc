@@ -0,0 +1,123 @@
+#include "perf_counters.hh"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#endif
+
+const char *PerfCounters::name(Counter counter) {
+  static const char *names[COUNT] = {"cycles", "instructions", "llc_misses",
+                                     "fp_vector"};
+  return names[counter];
+}
+
+PerfCounters::~PerfCounters() { close(); }
+
+#ifdef __linux__
+
+// Packed SSE/AVX arithmetic has no generic perf event; on Intel it is
+// FP_ARITH_INST_RETIRED with the 128/256-bit packed umasks
+static bool intelCpu() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line))
+    if (line.rfind("vendor_id", 0) == 0)
+      return line.find("GenuineIntel") != std::string::npos;
+  return false;
+}
+
+static int openCounter(uint32_t type, uint64_t config, pid_t tid) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+}
+
+bool PerfCounters::open() {
+  close();
+
+  struct Event {
+    uint32_t type;
+    uint64_t config;
+  };
+  Event events[COUNT] = {
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+      {PERF_TYPE_RAW, 0x3cc7}, // FP_ARITH_INST_RETIRED.{128,256}B_PACKED_*
+  };
+  bool intel = intelCpu();
+
+  DIR *dir = opendir("/proc/self/task");
+  if (!dir)
+    return false;
+  while (dirent *entry = readdir(dir)) {
+    if (entry->d_name[0] == '.')
+      continue;
+    pid_t tid = std::atoi(entry->d_name);
+    std::array<int, COUNT> thread;
+    for (int c = 0; c < COUNT; c++) {
+      thread[c] = c == FP_VECTOR && !intel
+                      ? -1
+                      : openCounter(events[c].type, events[c].config, tid);
+      if (thread[c] >= 0)
+        opened[c] = true;
+    }
+    fds.push_back(thread);
+  }
+  closedir(dir);
+
+  for (auto &thread : fds)
+    for (int fd : thread)
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+  return opened[CYCLES] || opened[INSTRUCTIONS];
+}
+
+void PerfCounters::close() {
+  for (auto &thread : fds)
+    for (int fd : thread)
+      if (fd >= 0)
+        ::close(fd);
+  fds.clear();
+  opened = {};
+}
+
+PerfCounters::Values PerfCounters::read() const {
+  Values total = {};
+  for (auto &thread : fds)
+    for (int c = 0; c < COUNT; c++) {
+      uint64_t v[3]; // value, time enabled, time running
+      if (thread[c] < 0 || ::read(thread[c], v, sizeof(v)) != sizeof(v))
+        continue;
+      if (v[2] > 0 && v[2] < v[1])
+        v[0] = uint64_t(double(v[0]) * v[1] / v[2]);
+      total[c] += v[0];
+    }
+  return total;
+}
+
+#else
+
+bool PerfCounters::open() { return false; }
+void PerfCounters::close() {}
+PerfCounters::Values PerfCounters::read() const { return {}; }
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Hardware performance counters (Linux perf_event) over every thread of
+// the process: the caller plus the Kokkos host backend's workers. Counters
+// the kernel or CPU does not offer read as zero and report !available().
+// Multiplexed counters are scaled to the full interval.
+//
+// Needs kernel.perf_event_paranoid <= 2 (the usual default) for counting
+// the process's own threads; elsewhere open() returns false.
+class PerfCounters {
+public:
+  enum Counter { CYCLES, INSTRUCTIONS, LLC_MISSES, FP_VECTOR, COUNT };
+  using Values = std::array<uint64_t, COUNT>;
+
+  static const char *name(Counter counter);
+
+  PerfCounters() = default;
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  // Open and start counting on the threads that exist now; call after
+  // Kokkos::initialize so its thread pool is included
+  bool open();
+  void close();
+  bool available(Counter counter) const { return opened[counter]; }
+
+  // Totals since open(), summed over threads
+  Values read() const;
+
+private:
+  std::vector<std::array<int, COUNT>> fds; // per thread, -1 if unavailable
+  std::array<bool, COUNT> opened = {};
+};
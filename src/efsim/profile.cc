@@ -0,0 +1,102 @@
+#include "profile.hh"
+
+#include <algorithm>
+
+#include "efsim/trace.hh"
+
+int PhaseProfile::phase(const char *name) {
+  for (size_t k = 0; k < phases.size(); k++)
+    if (phases[k].name == name)
+      return k;
+  phases.push_back({name, {}, 0, {}});
+  phases.back().ring.reserve(WINDOW);
+  return phases.size() - 1;
+}
+
+void PhaseProfile::record(int phase, double seconds) {
+  Samples &p = phases[phase];
+  float ms = seconds * 1e3;
+  if (int(p.ring.size()) < WINDOW)
+    p.ring.push_back(ms);
+  else
+    p.ring[p.next] = ms;
+  p.next = (p.next + 1) % WINDOW;
+}
+
+void PhaseProfile::count(int phase, const PerfCounters::Values &delta) {
+  for (int c = 0; c < PerfCounters::COUNT; c++)
+    phases[phase].counts[c] += delta[c];
+}
+
+std::vector<PerfCounters::Values> PhaseProfile::counts() const {
+  std::vector<PerfCounters::Values> out;
+  for (const Samples &p : phases)
+    out.push_back(p.counts);
+  return out;
+}
+
+std::vector<PhaseSummary> PhaseProfile::summary() const {
+  std::vector<PhaseSummary> out;
+  out.reserve(phases.size());
+  for (const Samples &p : phases) {
+    PhaseSummary s;
+    s.name = p.name;
+    if (!p.ring.empty()) {
+      std::vector<float> sorted = p.ring;
+      std::sort(sorted.begin(), sorted.end());
+      float sum = 0.0f;
+      for (float ms : sorted)
+        sum += ms;
+      s.mean = sum / sorted.size();
+      s.p95 = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+      s.max = sorted.back();
+    }
+    out.push_back(s);
+  }
+  return out;
+}
+
+void PhaseProfile::clear() {
+  for (Samples &p : phases) {
+    p.ring.clear();
+    p.next = 0;
+    p.counts = {};
+  }
+}
+
+ScopedPhase::ScopedPhase(PhaseProfile &profile, const char *name,
+                         bool device)
+    : profile(profile), index(-1), device(device),
+      traced(!device && Trace::recording()) {
+  if (device)
+    Kokkos::Profiling::pushRegion(name);
+  else if (traced)
+    Trace::begin(name);
+  if (!profile.enabled)
+    return;
+  index = profile.phase(name);
+  if (device) {
+    Kokkos::DefaultExecutionSpace().fence("Phase begin");
+    if (profile.counters)
+      start = profile.counters->read();
+  }
+  timer.reset();
+}
+
+ScopedPhase::~ScopedPhase() {
+  if (index >= 0) {
+    if (device)
+      Kokkos::DefaultExecutionSpace().fence("Phase end");
+    profile.record(index, timer.seconds());
+    if (device && profile.counters) {
+      PerfCounters::Values end = profile.counters->read();
+      for (int c = 0; c < PerfCounters::COUNT; c++)
+        end[c] -= start[c];
+      profile.count(index, end);
+    }
+  }
+  if (device)
+    Kokkos::Profiling::popRegion();
+  else if (traced)
+    Trace::end();
+}
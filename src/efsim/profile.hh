@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Kokkos_Core.hpp>
+#include <string>
+#include <vector>
+
+#include "efsim/perf_counters.hh"
+
+// Rolling statistics of one phase, in milliseconds
+struct PhaseSummary {
+  std::string name;
+  float mean = 0.0f;
+  float p95 = 0.0f;
+  float max = 0.0f;
+};
+
+// Named phases of a thread's work. Phases of device work are Kokkos
+// profiling regions, so Kokkos Tools (space-time-stack, kernel logger) see
+// the same structure. When `enabled`, phases are also timed, keeping the
+// last WINDOW samples of each. Not thread safe: one profile per thread.
+class PhaseProfile {
+public:
+  static const int WINDOW = 128;
+
+  bool enabled = false;
+  // Optional hardware counters, read at the ends of device phases
+  PerfCounters *counters = nullptr;
+
+  // Index of the phase called `name`, registered on first use
+  int phase(const char *name);
+  void record(int phase, double seconds);
+  void count(int phase, const PerfCounters::Values &delta);
+
+  // Phases in registration order
+  std::vector<PhaseSummary> summary() const;
+  // Counter totals of each phase since clear(), in registration order
+  std::vector<PerfCounters::Values> counts() const;
+  void clear();
+
+private:
+  struct Samples {
+    std::string name;
+    std::vector<float> ring; // ms
+    int next = 0;
+    PerfCounters::Values counts = {};
+  };
+  std::vector<Samples> phases;
+};
+
+// Times the enclosing scope as a phase of `profile`. On the thread that
+// issues the device work (`device`), the phase is a Kokkos profiling region
+// and the default execution space instance is fenced on entry and exit, so
+// its time covers its kernels. Other threads (the render thread) get plain
+// wall-clock timers: fencing there would wait on the solver, and Kokkos
+// Tools expect regions from one thread; their phases are recorded by Trace
+// directly.
+class ScopedPhase {
+public:
+  ScopedPhase(PhaseProfile &profile, const char *name, bool device = true);
+  ~ScopedPhase();
+  ScopedPhase(const ScopedPhase &) = delete;
+  ScopedPhase &operator=(const ScopedPhase &) = delete;
+
+private:
+  PhaseProfile &profile;
+  int index;
+  bool device;
+  bool traced; // host phase recorded by Trace
+  Kokkos::Timer timer;
+  PerfCounters::Values start = {};
+};
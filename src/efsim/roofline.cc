@@ -0,0 +1,158 @@
+#include "roofline.hh"
+
+#include <Kokkos_Core.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+#include "consts.hh"
+#include "efsim/trace.hh"
+
+const std::vector<KernelCost> &kernel_costs() {
+  const double cells = double(WIDTH) * HEIGHT;
+  // Per-item estimates from the kernel bodies: a bilinear velocity sample
+  // (interpolateDevice) is ~35 flops, floats and ints are 4 bytes
+  static const std::vector<KernelCost> costs = {
+      // s x2, u, v sampled, xtmp / ytmp written; two velocity samples
+      {"Advect Xgrid", cells, 16, 80},
+      {"Advect Ygrid", cells, 16, 80},
+      // u, v read, div written
+      {"ComputeDivergence", cells, 12, 3},
+      // p and div read, p_tmp written
+      {"PressureJacobi", cells, 12, 5},
+      // RBGS colour pass: s, u and v read and written, half the cells work
+      {"ClearDiv_RBGS", cells, 20, 8},
+      // u (or v) read and written, p read
+      {"SubGradU", cells, 12, 2},
+      {"SubGradV", cells, 12, 2},
+      // s, u, v, f read, tmp and beta updated atomically
+      {"Conservative Backward Trace", cells, 32, 60},
+      // s, beta, f read, leftover cells resample the velocity
+      {"Beta Forward Redistribution", cells, 20, 30},
+      {"VOF Backward Trace", cells, 32, 60},
+      {"VOF Leftover Redistribution", cells, 20, 30},
+      // tmp read and written, overflowing cells resample the velocity
+      {"VOF Clamp", cells, 8, 4},
+  };
+  return costs;
+}
+
+double stream_bandwidth() {
+  const size_t n = size_t(1) << 25; // 3 x 128 MiB of floats
+  Kokkos::View<float *> a("Stream a", n), b("Stream b", n), c("Stream c", n);
+  Kokkos::deep_copy(b, 1.0f);
+  Kokkos::deep_copy(c, 2.0f);
+
+  const float q = 3.0f;
+  double best = 1e30;
+  for (int rep = 0; rep < 10; rep++) {
+    Kokkos::fence();
+    Kokkos::Timer timer;
+    Kokkos::parallel_for(
+        "Stream Triad", Kokkos::RangePolicy<>(0, n),
+        KOKKOS_LAMBDA(size_t k) { a(k) = b(k) + q * c(k); });
+    Kokkos::fence();
+    best = std::min(best, timer.seconds());
+  }
+  return 3.0 * sizeof(float) * n / best;
+}
+
+namespace {
+
+struct Timing {
+  long launches = 0;
+  double seconds = 0.0;
+};
+
+// Only the thread that launches kernels calls back, so no locking
+std::map<std::string, Timing> timings;
+const KernelCost *current = nullptr;
+Kokkos::Timer timer;
+bool collecting = false;
+
+const KernelCost *find(const char *label) {
+  for (const KernelCost &cost : kernel_costs())
+    if (std::strcmp(cost.label, label) == 0)
+      return &cost;
+  return nullptr;
+}
+
+void beginKernel(const char *name, uint32_t, uint64_t *id) {
+  *id = 0;
+  current = find(name);
+  if (current) {
+    Kokkos::fence("Roofline begin");
+    timer.reset();
+  }
+}
+
+void endKernel(uint64_t) {
+  if (!current)
+    return;
+  Kokkos::fence("Roofline end");
+  Timing &t = timings[current->label];
+  t.launches++;
+  t.seconds += timer.seconds();
+  current = nullptr;
+}
+
+// Callbacks installed before start(), restored by stop()
+Kokkos::Tools::Experimental::EventSet saved;
+
+} // namespace
+
+bool Roofline::start() {
+  if (Trace::recording())
+    return false;
+  timings.clear();
+  using namespace Kokkos::Tools::Experimental;
+  saved = get_callbacks();
+  EventSet events = saved;
+  events.begin_parallel_for = beginKernel;
+  events.end_parallel_for = endKernel;
+  set_callbacks(events);
+  collecting = true;
+  return true;
+}
+
+void Roofline::stop() {
+  if (!collecting)
+    return;
+  Kokkos::Tools::Experimental::set_callbacks(saved);
+  collecting = false;
+}
+
+std::map<std::string, long> Roofline::launches() {
+  std::map<std::string, long> counts;
+  for (const auto &entry : timings)
+    counts[entry.first] = entry.second.launches;
+  return counts;
+}
+
+std::vector<KernelRoofline> Roofline::report(double peak) {
+  std::vector<KernelRoofline> rows;
+  for (const KernelCost &cost : kernel_costs()) {
+    auto it = timings.find(cost.label);
+    if (it == timings.end() || it->second.seconds <= 0.0)
+      continue;
+
+    KernelRoofline r;
+    r.label = cost.label;
+    r.launches = it->second.launches;
+    r.seconds = it->second.seconds;
+    double bytes = cost.items * cost.bytesPerItem * r.launches;
+    double flops = cost.items * cost.flopsPerItem * r.launches;
+    r.gbps = bytes / r.seconds * 1e-9;
+    r.gflops = flops / r.seconds * 1e-9;
+    r.intensity = cost.flopsPerItem / cost.bytesPerItem;
+    r.ofPeak = peak > 0.0 ? bytes / r.seconds / peak : 0.0;
+    r.lost = peak > 0.0 ? r.seconds - bytes / peak : 0.0;
+    rows.push_back(r);
+  }
+  std::sort(rows.begin(), rows.end(),
+            [](const KernelRoofline &a, const KernelRoofline &b) {
+              return a.lost > b.lost;
+            });
+  return rows;
+}
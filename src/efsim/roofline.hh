@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Declared work of one kernel launch, for roofline accounting. Bytes are
+// the compulsory traffic (each array touched read or written once, no
+// cache reuse across launches), flops the arithmetic of one work item.
+struct KernelCost {
+  const char *label; // the kernel's Kokkos label
+  double items;      // work items per launch
+  double bytesPerItem;
+  double flopsPerItem;
+};
+
+// Costs of the solver kernels at the compiled grid size
+const std::vector<KernelCost> &kernel_costs();
+
+// Sustained device memory bandwidth in bytes/s, from a STREAM triad
+// (a = b + q * c) over arrays well beyond the last-level cache
+double stream_bandwidth();
+
+// Achieved performance of one kernel while Roofline was collecting
+struct KernelRoofline {
+  std::string label;
+  long launches = 0;
+  double seconds = 0.0;
+  double gbps = 0.0;      // achieved GB/s
+  double gflops = 0.0;    // achieved GFLOP/s
+  double intensity = 0.0; // flops per byte
+  double ofPeak = 0.0;    // fraction of the STREAM bandwidth
+  double lost = 0.0;      // seconds over running at STREAM bandwidth
+};
+
+// Instrumentation mode: times every kernel that has a KernelCost. Kokkos
+// Tools callbacks fence before and after each launch, so kernel times are
+// exact but the run is slower; do not combine with Trace, which uses the
+// same callbacks. A KOKKOS_TOOLS_LIBS tool misses parallel_for events
+// while collecting and gets them back after stop().
+class Roofline {
+public:
+  // False if Trace is recording
+  static bool start();
+  static void stop();
+
+  // Launches of each declared kernel since start(), by label
+  static std::map<std::string, long> launches();
+
+  // One row per declared kernel that ran, largest `lost` first. `peak` is
+  // the bandwidth to compare against, see stream_bandwidth().
+  static std::vector<KernelRoofline> report(double peak);
+};
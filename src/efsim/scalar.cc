@@ -7,10 +7,11 @@
 #include "consts.hh"
 #include "efsim/mac.hh"
 #include "efsim/utils.hh"
-#include "gui/controlpanel.hh"
 
 ScalarField::ScalarField()
-    : field("Scalar Field", HEIGHT, WIDTH), tmp("Scalar tmp", HEIGHT, WIDTH) {
+    : field("Scalar Field", HEIGHT, WIDTH), tmp("Scalar tmp", HEIGHT, WIDTH),
+      weights(Kokkos::view_alloc(Kokkos::WithoutInitializing, "beta"), HEIGHT,
+              WIDTH) {
   init();
 }
 
@@ -61,8 +62,10 @@ void ScalarField::init() {
 
 // --------------------- Utilities -----------------
 void ScalarField::sync_host() {
+  Kokkos::Profiling::pushRegion("ScalarField::sync_host");
   field.modify_device();
   field.sync_host();
+  Kokkos::Profiling::popRegion();
 }
 
 float ScalarField::interpolateHost(float px, float py) {
@@ -74,9 +77,10 @@ void ScalarField::advect(Mac &mac, float deltaTime) {
   auto t = tmp;
   auto s = mac.sgrid.d_view;
 
-  auto beta = Kokkos::View<float **>("beta", HEIGHT, WIDTH);
-  Kokkos::deep_copy(t, 0.0f);
-  Kokkos::deep_copy(beta, 0.0f);
+  auto beta = weights;
+  Kokkos::DefaultExecutionSpace exec;
+  Kokkos::deep_copy(exec, t, 0.0f);
+  Kokkos::deep_copy(exec, beta, 0.0f);
 
   // Backward trace (scatter mass from source cell to arrival cells)
   Kokkos::parallel_for(
@@ -175,9 +179,8 @@ void ScalarField::advect(Mac &mac, float deltaTime) {
         Kokkos::atomic_add(&t(j1, i1), leftover * wx1 * wy1);
       });
 
-  Kokkos::deep_copy(f, t);
-
-  Kokkos::fence();
+  Kokkos::deep_copy(exec, f, t);
+  exec.fence();
 }
 
 void ScalarField::advect_vof(Mac &mac, float deltaTime) {
@@ -185,9 +188,10 @@ void ScalarField::advect_vof(Mac &mac, float deltaTime) {
   auto t = tmp;          // temp storage
   auto s = mac.sgrid.d_view;
 
-  auto beta = Kokkos::View<float **>("beta", HEIGHT, WIDTH);
-  Kokkos::deep_copy(t, 0.0f);
-  Kokkos::deep_copy(beta, 0.0f);
+  auto beta = weights;
+  Kokkos::DefaultExecutionSpace exec;
+  Kokkos::deep_copy(exec, t, 0.0f);
+  Kokkos::deep_copy(exec, beta, 0.0f);
 
   // Conservative backward trace (scatter)
   Kokkos::parallel_for(
@@ -304,7 +308,7 @@ void ScalarField::advect_vof(Mac &mac, float deltaTime) {
         Kokkos::atomic_add(&t(j1, i1), leftover * wx1 * wy1);
       });
 
-  Kokkos::fence();
+  exec.fence();
 
   // Clamp to [0,1] and redistribute overflow symmetrically (avoid walls)
   Kokkos::parallel_for(
@@ -348,7 +352,7 @@ void ScalarField::advect_vof(Mac &mac, float deltaTime) {
         }
       });
 
-  Kokkos::fence();
-  Kokkos::deep_copy(f, t);
+  Kokkos::deep_copy(exec, f, t);
+  exec.fence();
 }
 
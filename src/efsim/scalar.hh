@@ -9,6 +9,9 @@ public:
   ScalarField();
   Kokkos::DualView<float **> field;
   Kokkos::View<float **> tmp; // not initialized
+  // Arrival weights of the advection, zeroed by each call. Kept, since
+  // freeing a per-call view can synchronize the whole device.
+  Kokkos::View<float **> weights;
   void sync_host();
   void advect(Mac &mac, float deltaTime);
   void advect_vof(Mac &mac, float deltaTime);
@@ -3,7 +3,9 @@
 #include "efsim/advect.hh"
 #include "efsim/div.hh"
 
-Sim::Sim() : mac(), density() {}
+#include <type_traits>
+
+Sim::Sim(Scenario scenario) : mac(scenario), density() {}
 void Sim::setupBoundaryConditions(float inflowVelocity, float inflowDensity,
                                   int width) {
   auto xview = mac.xgrid.d_view;
@@ -14,12 +16,12 @@ void Sim::setupBoundaryConditions(float inflowVelocity, float inflowDensity,
 
   // --- Left wall inlet ---
   Kokkos::parallel_for(
-      Policy1D(0, HEIGHT), KOKKOS_LAMBDA(int j) {
+      "Inlet Velocity", Policy1D(0, HEIGHT), KOKKOS_LAMBDA(int j) {
         xview(j, 0) = inflowVelocity;
         xview(j, 1) = inflowVelocity;
       });
   Kokkos::parallel_for(
-      Policy1D(0, 40), KOKKOS_LAMBDA(int j) {
+      "Inlet Density", Policy1D(0, 40), KOKKOS_LAMBDA(int j) {
         dview(j + HEIGHT / 2, 0) = inflowDensity;
         dview(j + HEIGHT / 2, 1) = inflowDensity;
         dview(-j + HEIGHT / 2, 1) = inflowDensity;
@@ -28,7 +30,7 @@ void Sim::setupBoundaryConditions(float inflowVelocity, float inflowDensity,
 
   // --- Right wall: solid (no velocity outflow) ---
   Kokkos::parallel_for(
-      Policy1D(0, HEIGHT), KOKKOS_LAMBDA(int j) {
+      "Right Wall", Policy1D(0, HEIGHT), KOKKOS_LAMBDA(int j) {
         xview(j, WIDTH - 1) = 0.0f; // solid wall: no x-velocity
         yview(j, WIDTH - 1) = 0.0f; // solid wall: no y-velocity
         dview(j, WIDTH - 1) = 0.0f; // prevent density leaking
@@ -36,7 +38,7 @@ void Sim::setupBoundaryConditions(float inflowVelocity, float inflowDensity,
 
   // --- Top & bottom walls: solid ---
   Kokkos::parallel_for(
-      Policy1D(0, WIDTH), KOKKOS_LAMBDA(int i) {
+      "Top Bottom Walls", Policy1D(0, WIDTH), KOKKOS_LAMBDA(int i) {
         xview(0, i) = 0.0f; // bottom wall x-velocity
         yview(0, i) = 0.0f; // bottom wall y-velocity
         dview(0, i) = 0.0f; // bottom wall density
@@ -45,8 +47,6 @@ void Sim::setupBoundaryConditions(float inflowVelocity, float inflowDensity,
         yview(HEIGHT - 1, i) = 0.0f; // top wall y-velocity
         dview(HEIGHT - 1, i) = 0.0f; // top wall density
       });
-
-  density.sync_host();
 }
 
 void Sim::setupInitialDensity(int width, int consentration) {
@@ -65,20 +65,61 @@ void Sim::setupInitialDensity(int width, int consentration) {
   density.sync_host();
 }
 
-void Sim::addWall(int x, int y) { mac.toggleWall(x, y); }
-void Sim::step(float deltaTime, ControlPanel &ctrlPanel) {
-  setupBoundaryConditions(ctrlPanel.velocity, ctrlPanel.inflowDensity, 10);
-
-  compute_divergence(mac);
-
-  solve_pressure(mac, ctrlPanel.iters);
-  subtract_pressure_gradient(mac);
-
-  advect(mac, deltaTime, ctrlPanel.gravity);
-  if (ctrlPanel.vofAdvection)
-    density.advect_vof(mac, ctrlPanel.dt);
-  else
-    density.advect(mac, ctrlPanel.dt);
+size_t Sim::bytes() const {
+  auto size = [](const auto &view) {
+    using T = typename std::decay_t<decltype(view)>::value_type;
+    return view.span() * sizeof(T);
+  };
+  return size(mac.xgrid.d_view) + size(mac.ygrid.d_view) +
+         size(mac.sgrid.d_view) + size(mac.xtmp.d_view) +
+         size(mac.ytmp.d_view) + size(mac.div.d_view) +
+         size(mac.pressure.d_view) + size(mac.pressure_tmp.d_view) +
+         size(density.field.d_view) + size(density.tmp) +
+         size(density.weights);
+}
 
-  mac.sync_host();
+void Sim::addWall(int x, int y) { mac.toggleWall(x, y); }
+void Sim::step(float deltaTime, const SimParams &params) {
+  Kokkos::Profiling::pushRegion("Sim::step");
+  {
+    ScopedPhase phase(profile, "Boundary");
+    setupBoundaryConditions(params.velocity, params.inflowDensity, 10);
+  }
+  if (params.solver == Solver::RedBlack) {
+    ScopedPhase phase(profile, "Pressure");
+    // Never written by RBGS: zeroed once, so it doesn't keep showing the
+    // last Jacobi solve
+    if (lastSolver != Solver::RedBlack)
+      Kokkos::deep_copy(Kokkos::DefaultExecutionSpace(), mac.pressure.d_view,
+                        0.0f);
+    clear_divergence_opti(mac, params.iters, OVERRELAXATION);
+  } else {
+    {
+      ScopedPhase phase(profile, "Divergence");
+      compute_divergence(mac);
+    }
+    {
+      ScopedPhase phase(profile, "Pressure");
+      solve_pressure(mac, params.iters);
+    }
+    {
+      ScopedPhase phase(profile, "Gradient");
+      subtract_pressure_gradient(mac);
+    }
+  }
+  {
+    ScopedPhase phase(profile, "Advect");
+    advect(mac, deltaTime, params.gravity);
+  }
+  {
+    ScopedPhase phase(profile, "Density");
+    if (params.vofAdvection)
+      density.advect_vof(mac, params.dt);
+    else
+      density.advect(mac, params.dt);
+  }
+  lastSolver = params.solver;
+  steps++;
+  time += deltaTime;
+  Kokkos::Profiling::popRegion();
 }
@@ -1,19 +1,27 @@
 #pragma once
+#include <cstddef>
 #include "efsim/advect.hh"
 #include "efsim/div.hh"
 #include "efsim/mac.hh"
 #include "efsim/scalar.hh"
-#include "gui/controlpanel.hh"
+#include "efsim/params.hh"
+#include "efsim/profile.hh"
 
 class Sim {
 public:
   Mac mac;
   ScalarField density;
-  Sim();
+  PhaseProfile profile; // phases of step(), see ScopedPhase
+  long steps = 0;       // taken since init or the loaded checkpoint's
+  double time = 0.0;    // sum of their time steps
+  Solver lastSolver = Solver::Jacobi; // of the previous step
+  Sim(Scenario scenario = Scenario::Cylinder);
   void setupInitialDensity(int width, int consentration);
 
 void setupBoundaryConditions(float inflowVelocity, float inflowDensity, int width);
 
   void addWall(int x, int y);
-  void step(float deltaTime, ControlPanel &ctrlPanel);
+  void step(float deltaTime, const SimParams &params);
+  // Device memory held by the grids
+  size_t bytes() const;
 };
@@ -0,0 +1,91 @@
+#include "streamlines.hh"
+
+#include "consts.hh"
+
+using Policy1D = Kokkos::RangePolicy<>;
+
+void seed_inlet(const LinePoints &seeds) {
+  auto p = seeds;
+  const int lines = seeds.extent(0);
+  Kokkos::parallel_for(
+      "Seed Inlet", Policy1D(0, lines), KOKKOS_LAMBDA(int k) {
+        p(k, 0) = 1.5f;
+        p(k, 1) = (k + 0.5f) * HEIGHT / lines;
+      });
+  Kokkos::DefaultExecutionSpace().fence();
+}
+
+void trace_streamlines(Mac &mac, const LinePoints &seeds, int length,
+                       float ds, const LinePoints &out) {
+  auto s = mac.sgrid.d_view;
+  auto seed = seeds;
+  auto o = out;
+
+  Kokkos::parallel_for(
+      "Trace Streamlines", Policy1D(0, seeds.extent(0)), KOKKOS_LAMBDA(int k) {
+        const int base = k * length;
+        float x = seed(k, 0);
+        float y = seed(k, 1);
+        o(base, 0) = x;
+        o(base, 1) = y;
+
+        int n = 1;
+        for (; n < length; n++) {
+          auto next = rk4(mac, x, y, ds, true);
+          if (!in_fluid(s, next.first, next.second))
+            break;
+          x = next.first;
+          y = next.second;
+          o(base + n, 0) = x;
+          o(base + n, 1) = y;
+        }
+        for (; n < length; n++) {
+          o(base + n, 0) = x;
+          o(base + n, 1) = y;
+        }
+      });
+  Kokkos::DefaultExecutionSpace().fence();
+}
+
+void reset_pathlines(const LinePoints &seeds, int length,
+                     const LinePoints &paths) {
+  auto seed = seeds;
+  auto o = paths;
+  Kokkos::parallel_for(
+      "Reset Pathlines", Policy1D(0, seeds.extent(0) * length),
+      KOKKOS_LAMBDA(int n) {
+        o(n, 0) = seed(n / length, 0);
+        o(n, 1) = seed(n / length, 1);
+      });
+  Kokkos::DefaultExecutionSpace().fence();
+}
+
+void advance_pathlines(Mac &mac, const LinePoints &seeds, int length,
+                       float dt, const LinePoints &paths) {
+  auto s = mac.sgrid.d_view;
+  auto seed = seeds;
+  auto o = paths;
+
+  Kokkos::parallel_for(
+      "Advance Pathlines", Policy1D(0, seeds.extent(0)), KOKKOS_LAMBDA(int k) {
+        const int base = k * length;
+        const int head = base + length - 1;
+        auto next = rk4(mac, o(head, 0), o(head, 1), dt, false);
+
+        if (!in_fluid(s, next.first, next.second)) {
+          for (int n = base; n <= head; n++) {
+            o(n, 0) = seed(k, 0);
+            o(n, 1) = seed(k, 1);
+          }
+          return;
+        }
+
+        for (int n = base; n < head; n++) {
+          o(n, 0) = o(n + 1, 0);
+          o(n, 1) = o(n + 1, 1);
+        }
+        o(head, 0) = next.first;
+        o(head, 1) = next.second;
+      });
+  Kokkos::DefaultExecutionSpace().fence();
+}
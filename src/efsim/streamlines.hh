@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Kokkos_Core.hpp>
+
+#include "consts.hh"
+#include "efsim/mac.hh"
+
+// Vertices of `lines` polylines of `length` points each, in grid
+// coordinates (x along i, y along j). Line k owns the points
+// [k * length, (k + 1) * length); a line that stops early repeats its last
+// point, so the buffer can be drawn with a fixed index list. LayoutRight on
+// every backend, so x and y are interleaved as the vertex buffer expects.
+using LinePoints = Kokkos::View<float *[2], Kokkos::LayoutRight>;
+
+// True if grid position (x, y) is inside the domain and in a fluid cell
+template <typename S>
+KOKKOS_INLINE_FUNCTION bool in_fluid(const S &s, float x, float y) {
+  if (!(x >= 0.0f && x < WIDTH && y >= 0.0f && y < HEIGHT))
+    return false;
+  return s(int(y) + 1, int(x) + 1) != 0;
+}
+
+// One RK4 step of dx/dt = u(x); with `unit` the velocity is normalized
+KOKKOS_INLINE_FUNCTION Kokkos::pair<float, float>
+rk4(const Mac &mac, float x, float y, float h, bool unit) {
+  auto vel = [&](float px, float py) {
+    auto v = mac.interpolateDevice(px, py);
+    if (unit) {
+      float n = Kokkos::sqrt(v.first * v.first + v.second * v.second);
+      if (n > 1e-12f) {
+        v.first /= n;
+        v.second /= n;
+      }
+    }
+    return v;
+  };
+
+  auto k1 = vel(x, y);
+  auto k2 = vel(x + 0.5f * h * k1.first, y + 0.5f * h * k1.second);
+  auto k3 = vel(x + 0.5f * h * k2.first, y + 0.5f * h * k2.second);
+  auto k4 = vel(x + h * k3.first, y + h * k3.second);
+
+  return {x + h / 6.0f * (k1.first + 2 * k2.first + 2 * k3.first + k4.first),
+          y + h / 6.0f *
+                  (k1.second + 2 * k2.second + 2 * k3.second + k4.second)};
+}
+
+// `lines` seeds spread evenly along the inlet
+void seed_inlet(const LinePoints &seeds);
+
+// Streamlines of the current velocity field, one thread per line. RK4 on
+// the normalized velocity, so consecutive points are `ds` cells apart.
+void trace_streamlines(Mac &mac, const LinePoints &seeds, int length,
+                       float ds, const LinePoints &out);
+
+// Reset every pathline to a particle sitting at its seed
+void reset_pathlines(const LinePoints &seeds, int length,
+                     const LinePoints &paths);
+
+// Advance each pathline's particle by `dt` (RK4) and append it to the
+// line's history, dropping the oldest point. Particles that leave the
+// fluid restart at their seed.
+void advance_pathlines(Mac &mac, const LinePoints &seeds, int length,
+                       float dt, const LinePoints &paths);
@@ -0,0 +1,204 @@
+#include "trace.hh"
+
+#include <Kokkos_Core.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> Trace::active{false};
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+struct Event {
+  int64_t ns; // since the start of the recording
+  char phase; // 'B'egin or 'E'nd
+  char name[55];
+};
+
+// Events of one thread. Only the owning thread writes; stop() reads once
+// recording is off and the write in flight, if any, has finished.
+struct Ring {
+  static const uint64_t CAPACITY = 1 << 16;
+  std::unique_ptr<Event[]> events{new Event[CAPACITY]};
+  std::atomic<uint64_t> head{0}; // events written since start()
+  std::atomic<bool> writing{false}; // inside record()
+  int tid = 0;
+  std::string thread;
+};
+
+std::mutex ringsMutex; // registration and export only
+std::vector<std::unique_ptr<Ring>> rings; // threads keep raw pointers
+clock::time_point origin;
+thread_local Ring *ring = nullptr;
+thread_local const char *threadName = nullptr;
+
+Ring &threadRing() {
+  if (!ring) {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    rings.push_back(std::make_unique<Ring>());
+    ring = rings.back().get();
+    ring->tid = rings.size() - 1;
+    ring->thread = threadName ? threadName : "";
+  }
+  return *ring;
+}
+
+void record(char phase, const char *name) {
+  Ring &r = threadRing();
+  // Pairs with the fence in stop(): either this write sees recording
+  // off, or stop() sees `writing` and waits for it
+  r.writing.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!Trace::recording()) {
+    r.writing.store(false, std::memory_order_relaxed);
+    return;
+  }
+  // Recording: synchronize with start(), which reset head and origin
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t n = r.head.load(std::memory_order_relaxed);
+  Event &e = r.events[n % Ring::CAPACITY];
+  e.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() -
+                                                              origin)
+             .count();
+  e.phase = phase;
+  e.name[0] = '\0';
+  if (name) {
+    std::strncpy(e.name, name, sizeof(e.name) - 1);
+    e.name[sizeof(e.name) - 1] = '\0';
+  }
+  r.head.store(n + 1, std::memory_order_release);
+  r.writing.store(false, std::memory_order_release);
+}
+
+// Kokkos Tools callbacks. Kernels and fences on one thread nest, so the
+// end events need no name.
+void beginKernel(const char *name, uint32_t, uint64_t *id) {
+  *id = 0;
+  record('B', name);
+}
+void endKernel(uint64_t) { record('E', nullptr); }
+void pushRegion(const char *name) { record('B', name); }
+void popRegion() { record('E', nullptr); }
+
+void beginDeepCopy(Kokkos::Tools::SpaceHandle, const char *dst, const void *,
+                   Kokkos::Tools::SpaceHandle, const char *, const void *,
+                   uint64_t) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "deep_copy %s", dst);
+  record('B', name);
+}
+void endDeepCopy() { record('E', nullptr); }
+
+// Callbacks installed before start(), e.g. by a KOKKOS_TOOLS_LIBS tool;
+// restored by stop()
+Kokkos::Tools::Experimental::EventSet saved;
+
+void install() {
+  using namespace Kokkos::Tools::Experimental;
+  saved = get_callbacks();
+  EventSet events = saved;
+  events.begin_parallel_for = beginKernel;
+  events.end_parallel_for = endKernel;
+  events.begin_parallel_reduce = beginKernel;
+  events.end_parallel_reduce = endKernel;
+  events.begin_parallel_scan = beginKernel;
+  events.end_parallel_scan = endKernel;
+  events.begin_fence = beginKernel;
+  events.end_fence = endKernel;
+  events.push_region = pushRegion;
+  events.pop_region = popRegion;
+  events.begin_deep_copy = beginDeepCopy;
+  events.end_deep_copy = endDeepCopy;
+  set_callbacks(events);
+}
+
+void uninstall() { Kokkos::Tools::Experimental::set_callbacks(saved); }
+
+void writeString(std::ostream &out, const char *s) {
+  out << '"';
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      out << '\\';
+    if (static_cast<unsigned char>(*s) >= 0x20)
+      out << *s;
+  }
+  out << '"';
+}
+
+} // namespace
+
+void Trace::start() {
+  if (active.load())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for (auto &r : rings)
+      r->head.store(0, std::memory_order_relaxed);
+    origin = clock::now();
+  }
+  install();
+  active.store(true);
+}
+
+bool Trace::stop(const std::string &path) {
+  if (!active.exchange(false))
+    return false;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uninstall();
+
+  std::lock_guard<std::mutex> lock(ringsMutex);
+  // Spans that began while recording may still be writing their end
+  for (auto &r : rings)
+    while (r->writing.load(std::memory_order_acquire))
+      std::this_thread::yield();
+  std::ofstream out(path);
+  out << "{\"traceEvents\":[\n";
+  bool first = true;
+  for (auto &r : rings) {
+    if (!r->thread.empty()) {
+      out << (first ? "" : ",\n")
+          << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"
+          << r->tid << ",\"args\":{\"name\":";
+      writeString(out, r->thread.c_str());
+      out << "}}";
+      first = false;
+    }
+
+    uint64_t head = r->head.load(std::memory_order_acquire);
+    uint64_t begin = head > Ring::CAPACITY ? head - Ring::CAPACITY : 0;
+    for (uint64_t n = begin; n < head; n++) {
+      const Event &e = r->events[n % Ring::CAPACITY];
+      out << (first ? "" : ",\n") << "{\"ph\":\"" << e.phase
+          << "\",\"pid\":0,\"tid\":" << r->tid << ",\"ts\":" << e.ns / 1000
+          << '.' << (e.ns / 100) % 10;
+      if (e.phase == 'B') {
+        out << ",\"name\":";
+        writeString(out, e.name);
+      }
+      out << "}";
+      first = false;
+    }
+  }
+  out << "\n]}\n";
+  return bool(out);
+}
+
+void Trace::nameThread(const char *name) {
+  threadName = name;
+  if (ring) {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ring->thread = name;
+  }
+}
+
+void Trace::begin(const char *name) { record('B', name); }
+
+void Trace::end() { record('E', nullptr); }
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+// Opt-in timeline recorder exported as Chrome trace JSON (chrome://tracing,
+// ui.perfetto.dev).
+//
+// While recording, Kokkos Tools callbacks log every kernel (by its label),
+// fence, deep copy and profiling region, and TraceScope logs host-side
+// spans such as texture uploads. Events go into a fixed-size ring per
+// thread that only its own thread writes, so recording takes no locks;
+// when a ring wraps, its oldest events are dropped. stop() waits for
+// writes in flight before exporting, and events after it are dropped. While not recording,
+// no callbacks are installed and TraceScope is a single relaxed load.
+//
+// The callbacks replace a tool loaded with KOKKOS_TOOLS_LIBS for the
+// duration of the recording; stop() puts the tool's callbacks back. Must
+// not overlap Roofline collection. start() and stop() swap global
+// callbacks, so call them while no other thread runs Kokkos work (the GUI
+// asks the sim thread, see SimThread::setTracing).
+class Trace {
+public:
+  static void start();
+  // Stop recording and write the events to `path`; false on I/O error
+  static bool stop(const std::string &path);
+
+  static bool recording() {
+    return active.load(std::memory_order_relaxed);
+  }
+
+  // Label the calling thread's track
+  static void nameThread(const char *name);
+
+  static void begin(const char *name);
+  static void end();
+
+private:
+  static std::atomic<bool> active;
+};
+
+// Records the enclosing scope as a span on the calling thread
+class TraceScope {
+public:
+  explicit TraceScope(const char *name) : on(Trace::recording()) {
+    if (on)
+      Trace::begin(name);
+  }
+  ~TraceScope() {
+    if (on)
+      Trace::end();
+  }
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+  bool on;
+};
@@ -0,0 +1,240 @@
+#include "video.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#ifdef __unix__
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "consts.hh"
+#include "efsim/trace.hh"
+#include "efsim/utils.hh"
+
+namespace {
+
+bool endsWith(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+#ifdef __unix__
+extern "C" char **environ;
+
+// ffmpeg with its stdin on a pipe, run from an argv so the path never
+// goes through a shell; the write end, or null
+std::FILE *spawnEncoder(const std::string &path, long &child) {
+  int fds[2];
+  if (pipe(fds) != 0)
+    return nullptr;
+  // Other children must not keep ffmpeg's stdin open
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+  // A leading '-' would be read as an option
+  const std::string target = path.rfind('-', 0) == 0 ? "./" + path : path;
+  const char *argv[] = {"ffmpeg", "-loglevel", "error", "-y",
+                        "-f", "yuv4mpegpipe", "-i", "-",
+                        "-c:v", "libx264", "-pix_fmt", "yuv420p",
+                        "-crf", "18", target.c_str(), nullptr};
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+  posix_spawn_file_actions_addclose(&actions, fds[0]);
+  posix_spawn_file_actions_addclose(&actions, fds[1]);
+  pid_t pid;
+  int error = posix_spawnp(&pid, "ffmpeg", &actions, nullptr,
+                           const_cast<char *const *>(argv), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  ::close(fds[0]);
+  if (error != 0) {
+    ::close(fds[1]);
+    return nullptr;
+  }
+  std::FILE *out = fdopen(fds[1], "wb");
+  if (!out) {
+    ::close(fds[1]);
+    waitpid(pid, nullptr, 0);
+    return nullptr;
+  }
+  child = pid;
+  return out;
+}
+
+// True if ffmpeg exited cleanly
+bool waitEncoder(long child) {
+  int status;
+  while (waitpid(pid_t(child), &status, 0) < 0)
+    if (errno != EINTR)
+      return false;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+#endif
+
+} // namespace
+
+VideoWriter::VideoWriter(const std::string &path,
+                         const VideoOptions &options) {
+  w = (options.width > 0 ? options.width : WIDTH) & ~1;
+  h = (options.height > 0 ? options.height : HEIGHT) & ~1;
+  if (w <= 0 || h <= 0) {
+    failed = true;
+    return;
+  }
+
+  fps = std::max(1, options.fps);
+
+  if (endsWith(path, ".y4m")) {
+    out = std::fopen(path.c_str(), "wb");
+  } else {
+#ifdef __unix__
+    out = spawnEncoder(path, child);
+#endif
+  }
+  if (!out) {
+    failed = true;
+    return;
+  }
+
+  const size_t bytes = size_t(w) * h * 3;
+  planes = Kokkos::View<unsigned char *>(
+      Kokkos::view_alloc(Kokkos::WithoutInitializing, "Video planes"), bytes);
+  pool.reserve(std::max(1, options.queueDepth));
+  for (int k = 0; k < std::max(1, options.queueDepth); k++)
+    pool.emplace_back(
+        Kokkos::view_alloc(Kokkos::WithoutInitializing, "Video frame"), bytes);
+  for (HostFrame &f : pool)
+    idle.push_back(&f);
+  thread = std::thread(&VideoWriter::run, this);
+}
+
+bool VideoWriter::close() {
+  if (thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+  }
+  if (out && std::fclose(out) != 0)
+    failed = true;
+  out = nullptr;
+#ifdef __unix__
+  if (child >= 0 && !waitEncoder(child))
+    failed = true;
+  child = -1;
+#endif
+  return ok();
+}
+
+void VideoWriter::frame(const Sim &sim) {
+  if (failed || !out)
+    return;
+  HostFrame *buffer;
+  {
+    Kokkos::Timer timer;
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return !idle.empty(); });
+    buffer = idle.back();
+    idle.pop_back();
+    blocked += timer.seconds();
+  }
+
+  auto d = sim.density.field.d_view;
+  auto s = sim.mac.sgrid.d_view;
+  auto p = planes;
+  const int fw = w, fh = h;
+  const size_t plane = size_t(w) * h;
+  const float sx = float(WIDTH) / w, sy = float(HEIGHT) / h;
+
+  // Pixel row r from the top is j, column c is i, as in the GUI
+  Kokkos::parallel_for(
+      "Video Colormap", MDPOL(fh, fw), KOKKOS_LAMBDA(int r, int c) {
+        const float px = (c + 0.5f) * sx, py = (r + 0.5f) * sy;
+        const int ci = Kokkos::min(int(px), WIDTH - 1);
+        const int cj = Kokkos::min(int(py), HEIGHT - 1);
+
+        float red, green, blue;
+        if (s(cj + 1, ci + 1) == 0) {
+          red = green = blue = 0.3f; // walls grey
+        } else {
+          // Bilinear between cell centres, clamped at the edges
+          const float fx = Kokkos::clamp(px - 0.5f, 0.0f, WIDTH - 1.0f);
+          const float fy = Kokkos::clamp(py - 0.5f, 0.0f, HEIGHT - 1.0f);
+          const int i0 = Kokkos::min(int(fx), WIDTH - 2);
+          const int j0 = Kokkos::min(int(fy), HEIGHT - 2);
+          const float tx = fx - i0, ty = fy - j0;
+          const float v = (1 - tx) * (1 - ty) * d(j0, i0) +
+                          tx * (1 - ty) * d(j0, i0 + 1) +
+                          (1 - tx) * ty * d(j0 + 1, i0) +
+                          tx * ty * d(j0 + 1, i0 + 1);
+          red = blue = 0.0f;
+          green = Kokkos::clamp(v, 0.0f, 1.0f);
+        }
+
+        // BT.601, studio swing, as YUV4MPEG2 expects
+        const size_t k = size_t(r) * fw + c;
+        p(k) = (unsigned char)(16.5f + 65.481f * red + 128.553f * green +
+                               24.966f * blue);
+        p(plane + k) = (unsigned char)(128.5f - 37.797f * red -
+                                       74.203f * green + 112.0f * blue);
+        p(2 * plane + k) = (unsigned char)(128.5f + 112.0f * red -
+                                           93.786f * green - 18.214f * blue);
+      });
+  Kokkos::deep_copy(*buffer, planes);
+  Kokkos::fence("VideoWriter::frame");
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(buffer);
+  }
+  cv.notify_all();
+}
+
+void VideoWriter::run() {
+  Trace::nameThread("video");
+#ifdef __unix__
+  // Writes to a dead ffmpeg fail with EPIPE instead of killing the process.
+  // SIGPIPE is raised on the writing thread, so blocking it here is enough.
+  sigset_t pipeSignal;
+  sigemptyset(&pipeSignal);
+  sigaddset(&pipeSignal, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+#endif
+  // The stream header, from this thread for the same reason
+  const int header =
+      std::fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", w, h, fps);
+  if (header < 0)
+    failed = true;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    cv.wait(lock, [&] { return stopping || !pending.empty(); });
+    if (pending.empty()) {
+      // Flushed here too, so close()'s fclose never writes to the pipe
+      if (std::fflush(out) != 0)
+        failed = true;
+      break; // stopping, and everything is written
+    }
+    HostFrame *buffer = pending.front();
+    pending.pop_front();
+    lock.unlock();
+    {
+      TraceScope scope("VideoWriter::write");
+      bool ok = std::fputs("FRAME\n", out) >= 0 &&
+                std::fwrite(buffer->data(), 1, buffer->size(), out) ==
+                    buffer->size();
+      if (ok)
+        written++;
+      else
+        failed = true;
+    }
+    lock.lock();
+    idle.push_back(buffer);
+    cv.notify_all();
+  }
+}
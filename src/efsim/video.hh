@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Kokkos_Core.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "efsim/sim.hh"
+
+struct VideoOptions {
+  int width = 0;  // frame size in pixels, 0 = one pixel per cell
+  int height = 0; // rounded down to even for 4:2:0 encoders
+  int fps = 30;
+  int queueDepth = 4; // frames in flight before frame() blocks
+};
+
+// Animation of the density without a window: each frame is colour-mapped
+// on device like the GUI's density view (green density, grey walls), at
+// any resolution, bilinearly sampled, as planar 4:4:4 Y'CbCr (BT.601). A
+// background thread streams frames from a pool of pinned buffers, so the
+// solver pays for the colour map and the device-to-host copy only; when
+// every buffer is queued, frame() waits (back-pressure).
+//
+// A `.y4m` path is written directly as a YUV4MPEG2 stream; any other path
+// is encoded by an ffmpeg process (H.264, found on PATH) fed through a
+// pipe; SIGPIPE is blocked on the writer thread only, so a dead ffmpeg is
+// a write error. frame() is for one thread. Destroy the writer before
+// Kokkos::finalize.
+class VideoWriter {
+public:
+  VideoWriter(const std::string &path, const VideoOptions &options);
+  ~VideoWriter() { close(); }
+  VideoWriter(const VideoWriter &) = delete;
+  VideoWriter &operator=(const VideoWriter &) = delete;
+
+  // False if the output could not be opened or a write failed
+  bool ok() const { return !failed.load(); }
+  int width() const { return w; }
+  int height() const { return h; }
+
+  void frame(const Sim &sim);
+  // Write what is queued, end the stream and wait for ffmpeg; false if
+  // anything failed. Further frames are dropped.
+  bool close();
+
+  long frames() const { return written.load(); }
+  // Time frame() spent waiting for a free buffer
+  double blockedSeconds() const { return blocked; }
+
+private:
+  using HostFrame =
+      Kokkos::View<unsigned char *, Kokkos::SharedHostPinnedSpace>;
+
+  void run();
+
+  int w = 0, h = 0;
+  std::FILE *out = nullptr;
+  long child = -1; // ffmpeg's pid, if out is its pipe
+  int fps = 30;
+  Kokkos::View<unsigned char *> planes; // Y, Cb, Cr on device
+  std::vector<HostFrame> pool;
+  std::vector<HostFrame *> idle;   // buffers frame() may fill
+  std::deque<HostFrame *> pending; // filled, not yet written
+  bool stopping = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread thread;
+
+  std::atomic<bool> failed{false};
+  std::atomic<long> written{0};
+  double blocked = 0.0;
+};
@@ -0,0 +1,204 @@
+#include "xdmf.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "consts.hh"
+
+namespace {
+
+// Offsets of the arrays in a frame file, in floats
+struct Layout {
+  size_t density, pressure, fluid, velocity, u, v, total;
+
+  Layout(int nx, int ny) {
+    const size_t cells = size_t(nx) * ny;
+    density = 0;
+    pressure = density + cells;
+    fluid = pressure + cells;
+    velocity = fluid + cells;
+    u = velocity + 3 * cells;
+    v = u + size_t(nx + 1) * ny;
+    total = v + size_t(nx) * (ny + 1);
+  }
+};
+
+void dataItem(std::ostream &out, const std::string &file, size_t offset,
+              const std::string &dims) {
+  out << "          <DataItem Format=\"Binary\" NumberType=\"Float\" "
+         "Precision=\"4\" Endian=\"Little\" Seek=\""
+      << offset * sizeof(float) << "\" Dimensions=\"" << dims << "\">"
+      << file << "</DataItem>\n";
+}
+
+void attribute(std::ostream &out, const char *name, const char *center,
+               const char *type, const std::string &file, size_t offset,
+               const std::string &dims) {
+  out << "        <Attribute Name=\"" << name << "\" Center=\"" << center
+      << "\" AttributeType=\"" << type << "\">\n";
+  dataItem(out, file, offset, dims);
+  out << "        </Attribute>\n";
+}
+
+// A mesh one cell thick; origin and spacing in XDMF's z y x order
+void mesh(std::ostream &out, const char *name, int nz, int ny, int nx,
+          double y0, double x0, int stride) {
+  out << "      <Grid Name=\"" << name << "\" GridType=\"Uniform\">\n"
+      << "        <Topology TopologyType=\"3DCoRectMesh\" Dimensions=\""
+      << nz << " " << ny << " " << nx << "\"/>\n"
+      << "        <Geometry GeometryType=\"ORIGIN_DXDYDZ\">\n"
+      << "          <DataItem Format=\"XML\" Dimensions=\"3\">0 " << y0 << " "
+      << x0 << "</DataItem>\n"
+      << "          <DataItem Format=\"XML\" Dimensions=\"3\">1 " << stride
+      << " " << stride << "</DataItem>\n"
+      << "        </Geometry>\n";
+}
+
+} // namespace
+
+XdmfExporter::XdmfExporter(const std::string &dir, const std::string &name,
+                           int stride, int indexEvery)
+    : dir(dir), name(name), stride(std::max(1, stride)),
+      indexEvery(std::max(1, indexEvery)), nx(WIDTH / this->stride),
+      ny(HEIGHT / this->stride),
+      staging(Kokkos::view_alloc(Kokkos::WithoutInitializing, "XDMF frame"),
+              Layout(nx, ny).total) {
+  std::filesystem::create_directories(dir);
+}
+
+bool XdmfExporter::write(Sim &sim) {
+  Kokkos::Profiling::pushRegion("XdmfExporter::write");
+  // From the device views: solve_pressure swaps pressure's d_view only, so
+  // the host views can be the other buffer on host backends. No copy there.
+  auto mirror = [](const auto &view) {
+    return Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), view);
+  };
+  auto d = mirror(sim.density.field.d_view);
+  auto p = mirror(sim.mac.pressure.d_view);
+  auto s = mirror(sim.mac.sgrid.d_view);
+  auto u = mirror(sim.mac.xgrid.d_view);
+  auto v = mirror(sim.mac.ygrid.d_view);
+  auto out = staging;
+  const int st = stride, w = nx, h = ny;
+  const Layout at(nx, ny);
+  const float area = 1.0f / (st * st);
+
+  using Host = Kokkos::DefaultHostExecutionSpace;
+  using HostPolicy = Kokkos::MDRangePolicy<Host, Kokkos::Rank<2>>;
+  Kokkos::parallel_for(
+      "XDMF Cells", HostPolicy({0, 0}, {h, w}), [=](int m, int k) {
+        float sd = 0, sp = 0, sf = 0, su = 0, sv = 0;
+        for (int j = m * st; j < (m + 1) * st; j++)
+          for (int i = k * st; i < (k + 1) * st; i++) {
+            sd += d(j, i);
+            sp += p(j, i);
+            sf += s(j + 1, i + 1) != 0;
+            su += 0.5f * (u(j, i) + u(j, i + 1));
+            sv += 0.5f * (v(j, i) + v(j + 1, i));
+          }
+        const size_t c = size_t(m) * w + k;
+        out(at.density + c) = sd * area;
+        out(at.pressure + c) = sp * area;
+        out(at.fluid + c) = sf * area;
+        out(at.velocity + 3 * c) = su * area;
+        out(at.velocity + 3 * c + 1) = sv * area;
+        out(at.velocity + 3 * c + 2) = 0.0f;
+      });
+  Kokkos::parallel_for(
+      "XDMF U Faces", HostPolicy({0, 0}, {h, w + 1}), [=](int m, int k) {
+        float sum = 0;
+        for (int j = m * st; j < (m + 1) * st; j++)
+          sum += u(j, k * st);
+        out(at.u + size_t(m) * (w + 1) + k) = sum / st;
+      });
+  Kokkos::parallel_for(
+      "XDMF V Faces", HostPolicy({0, 0}, {h + 1, w}), [=](int m, int k) {
+        float sum = 0;
+        for (int i = k * st; i < (k + 1) * st; i++)
+          sum += v(m * st, i);
+        out(at.v + size_t(m) * w + k) = sum / st;
+      });
+  Host().fence();
+
+  char file[256];
+  std::snprintf(file, sizeof(file), "%s_%06ld.bin", name.c_str(), sim.steps);
+  std::FILE *f =
+      std::fopen((std::filesystem::path(dir) / file).string().c_str(), "wb");
+  bool ok = f != nullptr;
+  if (f) {
+    // One unbuffered write of the whole frame
+    std::setvbuf(f, nullptr, _IONBF, 0);
+    ok = std::fwrite(out.data(), sizeof(float), at.total, f) == at.total;
+    ok = std::fclose(f) == 0 && ok;
+  }
+  if (ok) {
+    written += at.total * sizeof(float);
+    index.push_back({sim.steps, sim.time, file});
+    if (index.size() - indexed >= size_t(indexEvery))
+      ok = writeIndex();
+  }
+  Kokkos::Profiling::popRegion();
+  return ok;
+}
+
+bool XdmfExporter::close() {
+  return indexed == index.size() || writeIndex();
+}
+
+bool XdmfExporter::writeIndex() {
+  // Written aside and renamed, so readers never see half an index
+  const std::filesystem::path path =
+      std::filesystem::path(dir) / (name + ".xdmf");
+  const std::filesystem::path tmp = path.string() + ".tmp";
+  {
+    std::ofstream out(tmp);
+    const Layout at(nx, ny);
+    const std::string cells = "1 " + std::to_string(ny) + " " +
+                              std::to_string(nx);
+    out << "<?xml version=\"1.0\" ?>\n"
+        << "<Xdmf Version=\"2.0\">\n"
+        << "  <Domain>\n"
+        << "    <Grid Name=\"efsim\" GridType=\"Collection\" "
+           "CollectionType=\"Temporal\">\n";
+    for (const Frame &frame : index) {
+      out << "    <Grid Name=\"step " << frame.step
+          << "\" GridType=\"Collection\" CollectionType=\"Spatial\">\n"
+          << "      <Time Value=\"" << frame.time << "\"/>\n";
+
+      mesh(out, "cells", 2, ny + 1, nx + 1, 0.0, 0.0, stride);
+      attribute(out, "density", "Cell", "Scalar", frame.file, at.density,
+                cells);
+      attribute(out, "pressure", "Cell", "Scalar", frame.file, at.pressure,
+                cells);
+      attribute(out, "fluid", "Cell", "Scalar", frame.file, at.fluid, cells);
+      attribute(out, "velocity", "Cell", "Vector", frame.file, at.velocity,
+                cells + " 3");
+      out << "      </Grid>\n";
+
+      mesh(out, "u_faces", 1, ny, nx + 1, 0.5 * stride, 0.0, stride);
+      attribute(out, "u", "Node", "Scalar", frame.file, at.u,
+                "1 " + std::to_string(ny) + " " + std::to_string(nx + 1));
+      out << "      </Grid>\n";
+
+      mesh(out, "v_faces", 1, ny + 1, nx, 0.0, 0.5 * stride, stride);
+      attribute(out, "v", "Node", "Scalar", frame.file, at.v,
+                "1 " + std::to_string(ny + 1) + " " + std::to_string(nx));
+      out << "      </Grid>\n";
+
+      out << "    </Grid>\n";
+    }
+    out << "    </Grid>\n"
+        << "  </Domain>\n"
+        << "</Xdmf>\n";
+    if (!out)
+      return false;
+  }
+  std::error_code error;
+  std::filesystem::rename(tmp, path, error);
+  if (error)
+    return false;
+  indexed = index.size();
+  return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Kokkos_Core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "efsim/sim.hh"
+
+// Time series for ParaView / VisIt: `<name>.xdmf` indexes one raw
+// little-endian float32 file per frame, `<name>_<step>.bin`, written with
+// a single sequential write. The index is rewritten every `indexEvery`
+// frames and by close(), so it can be opened while a run is going and
+// lags the frame files by at most that many frames.
+//
+// Each frame is a spatial collection of three grids on the unit-spaced
+// domain (x along i, y along j, as 3D meshes one cell thick):
+//   cells    density, pressure, fluid (1 = fluid, 0 = solid) and velocity
+//            (face velocities averaged to cell centres), cell-centred
+//   u_faces  u at the centres of the x faces, (i, j + 1/2)
+//   v_faces  v at the centres of the y faces, (i + 1/2, j)
+// With a stride s > 1, cell fields are averaged over s x s blocks and the
+// face fields keep every s-th face line, averaged along it.
+class XdmfExporter {
+public:
+  XdmfExporter(const std::string &dir, const std::string &name = "efsim",
+               int stride = 1, int indexEvery = 10);
+  ~XdmfExporter() { close(); }
+  XdmfExporter(const XdmfExporter &) = delete;
+  XdmfExporter &operator=(const XdmfExporter &) = delete;
+
+  // Append the current state as a frame; false on I/O error
+  bool write(Sim &sim);
+  // Bring the index up to date; false on I/O error
+  bool close();
+
+  long frames() const { return long(index.size()); }
+  uint64_t bytes() const { return written; }
+
+private:
+  struct Frame {
+    long step;
+    double time;
+    std::string file;
+  };
+
+  bool writeIndex();
+
+  std::string dir, name;
+  int stride;
+  int indexEvery;
+  int nx, ny; // cells after downsampling
+  Kokkos::View<float *, Kokkos::HostSpace> staging; // one frame
+  std::vector<Frame> index;
+  size_t indexed = 0; // frames in the index file
+  uint64_t written = 0;
+};
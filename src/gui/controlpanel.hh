@@ -1,21 +1,93 @@
 #pragma once
 #include <imgui.h>
+#include <vector>
 #include "consts.hh"
+#include "efsim/params.hh"
+#include "efsim/profile.hh"
 
-struct ControlPanel {
-  float velocity = 3.0f;
-  float dt = 0.2f;
-  int iters = 40;
-  float inflowDensity = 0.5;
-  float gravity = 0.0f;
+// Everything the sim thread reads from the panel; SimThread::setParams
+// copies just this part
+struct PanelSettings : SimParams {
   float fps = 0.0f;
+  float sps = 0.0f; // simulation steps per second
+  int spf = 0;      // simulation steps per published frame
+  float frameBudget = 16.0f; // ms of stepping between snapshots
+  int maxSubsteps = 32;
+  int densityFormat = 2; // DisplayFormat of the display textures
+  bool matchWindow = true; // read back at window resolution, not grid
+  int viewWidth = WIDTH;   // framebuffer size, set by the render loop
+  int viewHeight = HEIGHT;
+  bool showPressure = false;
+  float clip = 1.0f; // % of cells clipped at each end of a field's range
+
+  // What the main view shows: density, a Derived field (view - 1) or LIC
+  enum { VIEW_DENSITY = 0, VIEW_LIC = 5 };
+  int view = VIEW_DENSITY;
+  int licLength = 20;  // cells traced each way
+  int licInterval = 4; // frames between LIC refreshes
+
+  bool showStreamlines = false;
+  bool pathlines = false;
+  int streamlineCount = 256;
+  int streamlineLength = 256;  // points per line
+  float streamlineStep = 2.0f; // cells between streamline points
+
+  // Wall painting: left button paints walls, right button erases
+  enum { BRUSH_FREEHAND = 0, BRUSH_RECTANGLE = 1, BRUSH_CIRCLE = 2 };
+  int brush = BRUSH_FREEHAND;
+  float brushRadius = 3.0f; // cells, freehand only
+
+  // Fenced per-phase timers, filled in by the render loop
+  bool timePhases = false;
+  bool recordTrace = false; // Chrome trace to efsim_trace.json while set
   bool limitFps = true;
-  bool vofAdvection = false;
   bool pause = false;
+};
+
+struct ControlPanel : PanelSettings {
+  std::vector<PhaseSummary> stepPhases;   // Sim::step, per step
+  std::vector<PhaseSummary> framePhases;  // sim thread, per frame
+  std::vector<PhaseSummary> renderPhases; // render thread, per frame
+// Mean time of each phase as one segment of a stacked bar, with mean / p95
+// / max in the tooltip
+static void phaseBar(const char *label, const std::vector<PhaseSummary> &phases) {
+    static const ImU32 colors[] = {IM_COL32(230, 85, 13, 255),
+                                   IM_COL32(49, 130, 189, 255),
+                                   IM_COL32(49, 163, 84, 255),
+                                   IM_COL32(117, 107, 177, 255),
+                                   IM_COL32(222, 45, 38, 255),
+                                   IM_COL32(253, 174, 107, 255),
+                                   IM_COL32(158, 202, 225, 255),
+                                   IM_COL32(161, 217, 155, 255)};
+    float total = 0.0f;
+    for (const PhaseSummary &p : phases)
+      total += p.mean;
+    ImGui::Text("%s: %.2f ms", label, total);
+    if (total <= 0.0f)
+      return;
+
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    float width = ImGui::GetContentRegionAvail().x;
+    float height = ImGui::GetTextLineHeight();
+    ImDrawList *draw = ImGui::GetWindowDrawList();
+    float x = pos.x;
+    for (size_t k = 0; k < phases.size(); k++) {
+      const PhaseSummary &p = phases[k];
+      float w = width * p.mean / total;
+      ImVec2 a(x, pos.y), b(x + w, pos.y + height);
+      draw->AddRectFilled(a, b, colors[k % 8]);
+      if (ImGui::IsMouseHoveringRect(a, b))
+        ImGui::SetTooltip("%s\nmean %.3f ms\np95  %.3f ms\nmax  %.3f ms",
+                          p.name.c_str(), p.mean, p.p95, p.max);
+      x += w;
+    }
+    ImGui::Dummy(ImVec2(width, height));
+}
+
 void draw() {
     // Set a smaller, square window
     ImGui::SetNextWindowPos(ImVec2(10, 10));
-    ImGui::SetNextWindowSize(ImVec2(300, 300));
+    ImGui::SetNextWindowSize(ImVec2(320, 700));
     ImGuiWindowFlags window_flags =
         ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize |
         ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoTitleBar;
@@ -37,9 +109,21 @@ void draw() {
 
     ImGui::TextColored(fpsColor, "FPS: %.1f", fps);
     ImGui::TextColored(fpsColor, "Dim: %i x %i", WIDTH, HEIGHT);
+    ImGui::Text("Steps/s: %.1f (%i per frame)", sps, spf);
+
+    ImGui::Checkbox("Phase timers", &timePhases);
+    ImGui::SameLine();
+    ImGui::Checkbox("Record trace", &recordTrace);
+    if (timePhases) {
+      phaseBar("Step", stepPhases);
+      phaseBar("Sim frame", framePhases);
+      phaseBar("Render", renderPhases);
+    }
 
     ImGui::Checkbox("Pause", &pause);
     ImGui::Checkbox("Limit FPS", &limitFps);
+    ImGui::SliderFloat("Frame budget (ms)", &frameBudget, 1.0f, 50.0f);
+    ImGui::SliderInt("Max substeps", &maxSubsteps, 1, 128);
     ImGui::SliderFloat("Dt", &dt, 0.001f, 0.4f);
     ImGui::SliderFloat("Gravity", &gravity, -10.0f, 10.0f);
 
@@ -47,14 +131,46 @@ void draw() {
     ImGui::Text("Velocity");
     ImGui::SliderFloat("Vel", &velocity, 0.0f, 300.0f);
 
+    ImGui::Separator();
+    ImGui::Text("Display");
+    const char *views[] = {"Density",    "Vorticity",   "Speed",
+                           "Divergence", "Q-criterion", "LIC"};
+    ImGui::Combo("View", &view, views, 6);
+    if (view == VIEW_LIC) {
+      ImGui::SliderInt("LIC length", &licLength, 4, 64);
+      ImGui::SliderInt("LIC every", &licInterval, 1, 30);
+    }
+    ImGui::Checkbox("Show pressure", &showPressure);
+    ImGui::SliderFloat("Clip %", &clip, 0.0f, 10.0f);
+
     ImGui::Separator();
     ImGui::Text("Streamlines");
+    ImGui::Checkbox("Show lines", &showStreamlines);
+    ImGui::SameLine();
+    ImGui::Checkbox("Pathlines", &pathlines);
+    ImGui::SliderInt("Lines", &streamlineCount, 16, 2048);
+    ImGui::SliderInt("Length", &streamlineLength, 16, 512);
+    ImGui::SliderFloat("Step", &streamlineStep, 0.25f, 8.0f);
+
+    ImGui::Separator();
+    ImGui::Text("Walls (LMB paint, RMB erase)");
+    const char *brushes[] = {"Freehand", "Rectangle", "Circle"};
+    ImGui::Combo("Brush", &brush, brushes, 3);
+    if (brush == BRUSH_FREEHAND)
+      ImGui::SliderFloat("Radius", &brushRadius, 0.5f, 32.0f);
 
     ImGui::Separator();
     ImGui::Text("Density");
     ImGui::SliderInt("Iterations", &iters, 10, 100);
+    int s = int(solver);
+    const char *solvers[] = {"Jacobi", "Red-black GS"};
+    ImGui::Combo("Solver", &s, solvers, 2);
+    solver = Solver(s);
     ImGui::SliderFloat("Concentration", &inflowDensity, 0.0f, 1.0f);
     ImGui::Checkbox("VOF advection", &vofAdvection);
+    const char *formats[] = {"32-bit float", "16-bit float", "8-bit unorm"};
+    ImGui::Combo("Precision", &densityFormat, formats, 3);
+    ImGui::Checkbox("Match window resolution", &matchWindow);
 
     ImGui::End();
     ImGui::PopStyleVar();
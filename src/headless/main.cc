@@ -0,0 +1,387 @@
+// Batch driver: runs the solver for a fixed number of steps without a
+// window or GL context and writes timings and density dumps.
+//
+//   sim_headless [--config FILE] [--scenario cylinder|airfoil|empty]
+//                [--steps N] [--dt DT] [--velocity V]
+//                [--iters N] [--solver jacobi|rbgs] [--density D]
+//                [--gravity G] [--vof]
+//                [--output-every K] [--out DIR] [--restart FILE]
+//                [--checkpoint-every K] [--codec none|lz4|zstd]
+//                [--series FILE] [--fields density,u,v,pressure]
+//                [--quantize] [--xdmf-every K] [--xdmf-stride S]
+//                [--video FILE] [--video-every K] [--video-size WxH]
+//                [--fps N] [--profile]
+//                [--trace FILE.json] [--roofline] [--perf]
+//                [--kokkos-...]
+//
+// A config file holds the same options as `key = value` lines (without
+// the dashes); later command-line options override it.
+#include <Kokkos_Core.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+#include "efsim/efsim.hh"
+
+struct RunOptions {
+  SimParams sim;
+  Scenario scenario = Scenario::Cylinder;
+  long steps = 1000;
+  long outputEvery = 0; // 0 = no field output
+  long checkpointEvery = 0; // 0 = no checkpoints
+  Codec codec = Codec::None;
+  std::string restart; // checkpoint to start from, empty = Mac::init
+  std::string series;  // FieldWriter file in `out`, empty = raw dumps
+  OutputOptions output;
+  long xdmfEvery = 0; // 0 = no ParaView export
+  int xdmfStride = 1; // downsampling of the export
+  std::string video;   // .y4m, or anything ffmpeg encodes; empty = off
+  long videoEvery = 1;
+  VideoOptions videoOptions;
+  bool profile = false;  // fenced per-phase timers
+  std::string trace;     // Chrome trace output, empty = off
+  bool roofline = false; // per-kernel GB/s and GFLOP/s vs STREAM
+  bool perf = false;     // hardware counters per phase (Linux)
+  std::string out = ".";
+};
+
+static bool applyOption(RunOptions &opts, const std::string &key,
+                        const std::string &value) {
+  if (key == "steps")
+    opts.steps = std::stol(value);
+  else if (key == "scenario")
+    return parse_scenario(value, opts.scenario);
+  else if (key == "dt")
+    opts.sim.dt = std::stof(value);
+  else if (key == "velocity")
+    opts.sim.velocity = std::stof(value);
+  else if (key == "iters")
+    opts.sim.iters = std::stoi(value);
+  else if (key == "solver")
+    return parse_solver(value, opts.sim.solver);
+  else if (key == "density")
+    opts.sim.inflowDensity = std::stof(value);
+  else if (key == "gravity")
+    opts.sim.gravity = std::stof(value);
+  else if (key == "vof")
+    opts.sim.vofAdvection = value != "0" && value != "false";
+  else if (key == "output-every")
+    opts.outputEvery = std::stol(value);
+  else if (key == "out")
+    opts.out = value;
+  else if (key == "restart")
+    opts.restart = value;
+  else if (key == "checkpoint-every")
+    opts.checkpointEvery = std::stol(value);
+  else if (key == "codec")
+    return parse_codec(value, opts.codec) &&
+           parse_codec(value, opts.output.codec);
+  else if (key == "xdmf-every")
+    opts.xdmfEvery = std::stol(value);
+  else if (key == "xdmf-stride")
+    opts.xdmfStride = std::stoi(value);
+  else if (key == "video")
+    opts.video = value;
+  else if (key == "video-every")
+    opts.videoEvery = std::max(1L, std::stol(value));
+  else if (key == "video-size")
+    return std::sscanf(value.c_str(), "%dx%d", &opts.videoOptions.width,
+                       &opts.videoOptions.height) == 2;
+  else if (key == "fps")
+    opts.videoOptions.fps = std::stoi(value);
+  else if (key == "series")
+    opts.series = value;
+  else if (key == "fields")
+    return parse_output_fields(value, opts.output.fields);
+  else if (key == "quantize")
+    opts.output.quantize = value != "0" && value != "false";
+  else if (key == "trace")
+    opts.trace = value;
+  else if (key == "roofline")
+    opts.roofline = value != "0" && value != "false";
+  else if (key == "perf")
+    opts.perf = value != "0" && value != "false";
+  else if (key == "profile")
+    opts.profile = value != "0" && value != "false";
+  else
+    return false;
+  return true;
+}
+
+// Apply one option; false if the key is unknown or the value malformed
+static bool setOption(RunOptions &opts, const std::string &key,
+                      const std::string &value) {
+  try {
+    return applyOption(opts, key, value);
+  } catch (const std::invalid_argument &) {
+    return false;
+  } catch (const std::out_of_range &) {
+    return false;
+  }
+}
+
+static bool readConfig(RunOptions &opts, const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Cannot open config " << path << "\n";
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    auto eq = line.find('=');
+    if (eq == std::string::npos)
+      continue;
+    std::string key, value;
+    std::istringstream(line.substr(0, eq)) >> key;
+    std::istringstream(line.substr(eq + 1)) >> value;
+    if (!setOption(opts, key, value)) {
+      std::cerr << path << ": bad option " << key << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+// Kokkos has already removed its own --kokkos-* arguments
+static bool parseArgs(RunOptions &opts, int argc, char *argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+
+  for (size_t k = 0; k + 1 < args.size(); k++)
+    if (args[k] == "--config" && !readConfig(opts, args[k + 1]))
+      return false;
+
+  for (size_t k = 0; k < args.size(); k++) {
+    if (args[k].rfind("--", 0) != 0) {
+      std::cerr << "Unexpected argument " << args[k] << "\n";
+      return false;
+    }
+    std::string key = args[k].substr(2);
+    if (key == "config") {
+      k++;
+      continue;
+    }
+    if (key == "vof" || key == "profile" || key == "roofline" ||
+        key == "perf" || key == "quantize") {
+      setOption(opts, key, "1");
+      continue;
+    }
+    if (k + 1 >= args.size() || !setOption(opts, key, args[k + 1])) {
+      std::cerr << "Bad option " << args[k] << "\n";
+      return false;
+    }
+    k++;
+  }
+  if (!opts.series.empty() && opts.outputEvery <= 0) {
+    std::cerr << "--series needs --output-every\n";
+    return false;
+  }
+  return true;
+}
+
+// Density as raw float32, HEIGHT rows of WIDTH values. Files are named by
+// Sim::steps, so runs restarted from a checkpoint continue the sequence.
+static void writeDensity(Sim &sim, const std::string &dir, long step) {
+  sim.density.sync_host();
+  char name[64];
+  std::snprintf(name, sizeof(name), "density_%06ld.raw", step);
+  std::ofstream file(std::filesystem::path(dir) / name, std::ios::binary);
+  auto h = sim.density.field.h_view;
+  for (int j = 0; j < HEIGHT; j++)
+    for (int i = 0; i < WIDTH; i++)
+      file.write(reinterpret_cast<const char *>(&h(j, i)), sizeof(float));
+}
+
+// Peak resident set of the process in MB, 0 where unknown
+static double maxRssMb() {
+#ifdef __unix__
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss / 1024.0; // kB on Linux
+#endif
+  return 0.0;
+}
+
+// The whole run; the exit status. Everything Kokkos allocates is freed
+// on return, before Kokkos::finalize.
+static int run(RunOptions &opts) {
+  int status = 0;
+  std::filesystem::create_directories(opts.out);
+
+  Sim sim(opts.scenario);
+  // Stop before any step or summary, which a script could otherwise take
+  // for the restarted run's
+  if (!opts.restart.empty() && !load_checkpoint(sim, opts.restart))
+    return 2;
+  sim.profile.enabled = opts.profile || opts.perf;
+  PerfCounters counters;
+  if (opts.perf) {
+    if (counters.open())
+      sim.profile.counters = &counters;
+    else
+      std::cerr << "perf_event counters unavailable\n";
+  }
+  std::unique_ptr<FieldWriter> writer;
+  if (!opts.series.empty())
+    writer = std::make_unique<FieldWriter>(
+        (std::filesystem::path(opts.out) / opts.series).string(),
+        opts.output);
+  std::unique_ptr<XdmfExporter> xdmf;
+  if (opts.xdmfEvery > 0)
+    xdmf = std::make_unique<XdmfExporter>(opts.out, "efsim", opts.xdmfStride);
+  std::unique_ptr<VideoWriter> video;
+  if (!opts.video.empty()) {
+    video = std::make_unique<VideoWriter>(opts.video, opts.videoOptions);
+    if (!video->ok()) {
+      std::cerr << "Cannot open video output " << opts.video << "\n";
+      status = 1;
+      video.reset();
+    }
+  }
+  std::ofstream timing(std::filesystem::path(opts.out) / "timing.csv");
+  timing << "step,seconds\n";
+
+  if (!opts.trace.empty())
+    Trace::start();
+  double peak = 0.0;
+  if (opts.roofline) {
+    peak = stream_bandwidth();
+    if (!Roofline::start()) {
+      std::cerr << "--roofline cannot be combined with --trace\n";
+      opts.roofline = false;
+    }
+  }
+
+  // Fixed time step, so runs are reproducible
+  Kokkos::Timer total;
+  for (long step = 1; step <= opts.steps; step++) {
+    Kokkos::Timer timer;
+    sim.step(opts.sim.dt, opts.sim);
+    Kokkos::fence();
+    timing << step << "," << timer.seconds() << "\n";
+
+    if (opts.outputEvery > 0 && sim.steps % opts.outputEvery == 0) {
+      if (writer)
+        writer->snapshot(sim);
+      else
+        writeDensity(sim, opts.out, sim.steps);
+    }
+    if (video && sim.steps % opts.videoEvery == 0)
+      video->frame(sim);
+    if (xdmf && sim.steps % opts.xdmfEvery == 0 && !xdmf->write(sim)) {
+      std::cerr << "Cannot write XDMF frame " << sim.steps << "\n";
+      status = 1;
+    }
+    if (opts.checkpointEvery > 0 && sim.steps % opts.checkpointEvery == 0) {
+      char name[64];
+      std::snprintf(name, sizeof(name), "checkpoint_%06ld.efck", sim.steps);
+      if (!save_checkpoint(
+              sim, (std::filesystem::path(opts.out) / name).string(),
+              opts.codec))
+        status = 1;
+    }
+  }
+  double seconds = total.seconds();
+  if (writer) {
+    writer->flush();
+    if (!writer->ok()) {
+      std::cerr << "Cannot write " << opts.series << "\n";
+      status = 1;
+    }
+  }
+  if (xdmf && !xdmf->close()) {
+    std::cerr << "Cannot write the XDMF index\n";
+    status = 1;
+  }
+  Roofline::stop();
+  if (!opts.trace.empty() && !Trace::stop(opts.trace)) {
+    std::cerr << "Cannot write " << opts.trace << "\n";
+    status = 1;
+  }
+
+  // One line, key=value, for scripts
+  double perStep = opts.steps > 0 ? seconds / opts.steps : 0.0;
+  std::cout << "width=" << WIDTH << " height=" << HEIGHT
+            << " steps=" << opts.steps << " seconds=" << seconds
+            << " ms_per_step=" << perStep * 1e3 << " mcells_per_s="
+            << (perStep > 0 ? WIDTH * double(HEIGHT) / perStep * 1e-6 : 0.0)
+            << " threads=" << Kokkos::DefaultExecutionSpace().concurrency()
+            << " solver=" << solver_name(opts.sim.solver)
+            << " memory_mb=" << sim.bytes() / double(1 << 20)
+            << " max_rss_mb=" << maxRssMb() << std::endl;
+  if (video) {
+    if (!video->close()) {
+      std::cerr << "Cannot write " << opts.video << "\n";
+      status = 1;
+    }
+    std::cout << "video_frames=" << video->frames() << " video_blocked_s="
+              << video->blockedSeconds() << "\n";
+  }
+  if (writer)
+    std::cout << "output_frames=" << writer->frames()
+              << " output_raw_mb=" << writer->rawBytes() / double(1 << 20)
+              << " output_file_mb=" << writer->fileBytes() / double(1 << 20)
+              << " output_blocked_s=" << writer->blockedSeconds() << "\n";
+  // Rolling statistics over the last PhaseProfile::WINDOW steps
+  for (const PhaseSummary &p : sim.profile.summary())
+    std::cout << "phase=" << p.name << " mean_ms=" << p.mean
+              << " p95_ms=" << p.p95 << " max_ms=" << p.max << "\n";
+  if (sim.profile.counters) {
+    // Per cell and step, over the whole run
+    auto counts = sim.profile.counts();
+    auto phases = sim.profile.summary();
+    double cellSteps = WIDTH * double(HEIGHT) * opts.steps;
+    std::printf("%-12s %10s %8s %8s %12s\n", "phase", "cycles/c", "IPC",
+                "LLC/c", "fp_vec/c");
+    for (size_t k = 0; k < phases.size(); k++) {
+      const auto &v = counts[k];
+      double ipc = v[PerfCounters::CYCLES]
+                       ? double(v[PerfCounters::INSTRUCTIONS]) /
+                             v[PerfCounters::CYCLES]
+                       : 0.0;
+      std::printf("%-12s %10.2f %8.2f %8.4f %12s\n", phases[k].name.c_str(),
+                  v[PerfCounters::CYCLES] / cellSteps, ipc,
+                  v[PerfCounters::LLC_MISSES] / cellSteps,
+                  counters.available(PerfCounters::FP_VECTOR)
+                      ? std::to_string(v[PerfCounters::FP_VECTOR] /
+                                       cellSteps)
+                            .c_str()
+                      : "n/a");
+    }
+  }
+  if (opts.roofline) {
+    std::printf("STREAM triad: %.1f GB/s\n", peak * 1e-9);
+    std::printf("%-28s %8s %10s %8s %8s %6s %7s %9s\n", "kernel", "calls",
+                "ms", "GB/s", "GFLOP/s", "F/B", "%peak", "lost ms");
+    for (const KernelRoofline &r : Roofline::report(peak))
+      std::printf("%-28s %8ld %10.2f %8.1f %8.2f %6.2f %6.1f%% %9.2f\n",
+                  r.label.c_str(), r.launches, r.seconds * 1e3, r.gbps,
+                  r.gflops, r.intensity, r.ofPeak * 100, r.lost * 1e3);
+  }
+  if (!timing)
+    status = 1;
+  return status;
+}
+
+int main(int argc, char *argv[]) {
+  Kokkos::initialize(argc, argv);
+  int status = 2;
+  {
+    RunOptions opts;
+    if (parseArgs(opts, argc, argv))
+      status = run(opts);
+  }
+  Kokkos::finalize();
+  return status;
+}
@@ -8,11 +8,14 @@
 #include <vector>
 #include "consts.hh"
 #include "efsim/sim.hh"
+#include "efsim/trace.hh"
 #include "gui/controlpanel.hh"
 #include "gui/gui.hh"
 #include "imgui.h"
 #include "imgui/backends/imgui_impl_opengl3.h"
 #include "renderer.hh"
+#include "sim_thread.hh"
+#include "streamline_renderer.hh"
 
 void updateDensity(std::vector<float> &densityData, int width, int height,
                    float time) {
@@ -33,6 +36,60 @@ void updateDensity(std::vector<float> &densityData, int width, int height,
     }
   }
 }
+// Mouse state of the wall brush between frames
+struct Stroke {
+  bool active = false;
+  int value = 0;
+  float x0 = 0, y0 = 0; // where the button went down
+  float lx = 0, ly = 0; // cursor in the previous frame
+};
+
+// Brush strokes for this frame's mouse input. Freehand paints a segment
+// from the previous cursor position every frame; rectangles and circles
+// are committed when the button is released.
+void paintStrokes(GLFWwindow *window, const ControlPanel &ctrlPanel,
+                  Stroke &stroke, std::vector<Brush> &brushes) {
+  bool left = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+  bool right =
+      glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+  bool down = (left || right) &&
+              (stroke.active || !ImGui::GetIO().WantCaptureMouse);
+
+  double mx, my;
+  int w, h;
+  glfwGetCursorPos(window, &mx, &my);
+  glfwGetWindowSize(window, &w, &h);
+  // Screen x runs along i, screen y (from the top) along j
+  float x = mx / w * WIDTH;
+  float y = my / h * HEIGHT;
+
+  bool started = down && !stroke.active;
+  if (started) {
+    stroke.active = true;
+    stroke.value = left ? 0 : 1;
+    stroke.x0 = stroke.lx = x;
+    stroke.y0 = stroke.ly = y;
+  }
+
+  if (down && ctrlPanel.brush == ControlPanel::BRUSH_FREEHAND &&
+      (started || x != stroke.lx || y != stroke.ly))
+    brushes.push_back(Brush::line(stroke.lx, stroke.ly, x, y,
+                                  ctrlPanel.brushRadius, stroke.value));
+
+  if (stroke.active && !down) {
+    if (ctrlPanel.brush == ControlPanel::BRUSH_RECTANGLE)
+      brushes.push_back(
+          Brush::rectangle(stroke.x0, stroke.y0, x, y, stroke.value));
+    else if (ctrlPanel.brush == ControlPanel::BRUSH_CIRCLE)
+      brushes.push_back(Brush::circle(stroke.x0, stroke.y0,
+                                      std::hypot(x - stroke.x0, y - stroke.y0),
+                                      stroke.value));
+    stroke.active = false;
+  }
+  stroke.lx = x;
+  stroke.ly = y;
+}
+
 int main() {
   Kokkos::initialize();
   {
@@ -55,6 +112,8 @@ int main() {
       glfwTerminate();
       return -1;
     }
+    // Persistently mapped texture streaming if the driver supports it
+    loadBufferStorage((GLADloadproc)glfwGetProcAddress);
 
     GUI gui(ctrlPanel, window);
     gui.setup();
@@ -67,13 +126,17 @@ int main() {
     };
 
     Renderer renderer(vertices, vertices.size());
-
-    // ✅ Create density + obstacle textures once
-    renderer.createDensityTexture(WIDTH, HEIGHT,
-                                  sim.density.field.h_view.data());
-    renderer.createObstacleTexture(WIDTH, HEIGHT, sim.mac.sgrid.h_view.data());
-    renderer.createPressureTexture(WIDTH, HEIGHT,
-                                   sim.mac.pressure.h_view.data());
+    StreamlineRenderer streamlines;
+
+    // ✅ Create density + obstacle textures once. Texture rows run along
+    // x, so the textures are HEIGHT texels wide.
+    renderer.createDensityTexture(HEIGHT, WIDTH,
+                                  DisplayFormat(ctrlPanel.densityFormat));
+    renderer.createObstacleTexture(HEIGHT, WIDTH, sim.mac.sgrid.h_view.data());
+    renderer.createPressureTexture(HEIGHT, WIDTH,
+                                   DisplayFormat(ctrlPanel.densityFormat));
+    renderer.createDerivedTexture(HEIGHT, WIDTH,
+                                  DisplayFormat(ctrlPanel.densityFormat));
 
     glBindTexture(GL_TEXTURE_2D, renderer.obstacleTexture);
 
@@ -83,37 +146,86 @@ int main() {
     sim.mac.sync_host();
     renderer.updateObstacle(sim.mac.sgrid);
 
-    glUniform1i(glGetUniformLocation(shader, "uMode"), 1); // density
+    // From here on only the sim thread touches the Kokkos views
+    SimThread simThread(sim);
+    simThread.setParams(ctrlPanel);
+    simThread.start();
+    Stroke stroke;
+    std::vector<Brush> brushes;
+    PhaseProfile renderProfile;
+    Trace::nameThread("render");
 
-    float lastTime = (float)glfwGetTime();
     while (!glfwWindowShouldClose(window)) {
-      float currentTime = (float)glfwGetTime();
-      float deltaTime = currentTime - lastTime;
-      lastTime = currentTime;
-
       glfwSwapInterval(ctrlPanel.limitFps); // 0 = no V-Sync, unlimited FPS
       gui.draw();
       ctrlPanel.fps = ImGui::GetIO().Framerate;
-
-      sim.step(deltaTime, ctrlPanel);
-
-      
-      /* renderer.updatePressure(sim.mac.pressure); */
-      renderer.updateDensity(sim.density.field);
-
-      glClear(GL_COLOR_BUFFER_BIT);
-      glUseProgram(shader);
-
-
-      renderer.draw(shader);
-
-      ImGui::Render();
-      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-
-      glfwSwapBuffers(window);
+      ctrlPanel.sps = simThread.stepsPerSecond();
+      ctrlPanel.spf = simThread.stepsPerFrame();
+      glfwGetFramebufferSize(window, &ctrlPanel.viewWidth,
+                             &ctrlPanel.viewHeight);
+      simThread.setParams(ctrlPanel);
+      if (renderProfile.enabled != ctrlPanel.timePhases) {
+        renderProfile.enabled = ctrlPanel.timePhases;
+        renderProfile.clear();
+      }
+      if (renderProfile.enabled)
+        ctrlPanel.renderPhases = renderProfile.summary();
+
+      // The obstacle texture is patched right away, the sim rasterizes the
+      // same strokes on device before its next frame
+      brushes.clear();
+      paintStrokes(window, ctrlPanel, stroke, brushes);
+      for (const Brush &brush : brushes)
+        renderer.updateObstacleBrush(brush);
+      if (!brushes.empty())
+        simThread.paint(brushes);
+
+      if (simThread.acquire()) {
+        ScopedPhase phase(renderProfile, "Upload", false);
+        const Snapshot &snap = simThread.latest();
+        ctrlPanel.stepPhases = snap.stepPhases;
+        ctrlPanel.framePhases = snap.framePhases;
+        renderer.updateDensity(snap.density.data.data(), snap.density.format,
+                               snap.density.width, snap.density.height);
+        if (snap.pressure.valid)
+          renderer.updatePressure(snap.pressure.data.data(),
+                                  snap.pressure.format, snap.pressure.width,
+                                  snap.pressure.height);
+        if (snap.derived.valid)
+          renderer.updateDerived(snap.derived.data.data(), snap.derived.format,
+                                 snap.derived.width, snap.derived.height);
+        if (snap.lines.valid)
+          streamlines.update(snap.lines.points.data(), snap.lines.lines,
+                             snap.lines.length);
+      }
+
+      {
+        ScopedPhase phase(renderProfile, "Draw", false);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glUseProgram(shader);
+        glUniform1i(glGetUniformLocation(shader, "uShowPressure"),
+                    ctrlPanel.showPressure);
+        // 1 = density, 2.. = derived fields in Derived order
+        glUniform1i(glGetUniformLocation(shader, "uMode"),
+                    ctrlPanel.view + 1);
+
+        renderer.draw(shader);
+        if (ctrlPanel.showStreamlines)
+          streamlines.draw();
+      }
+      {
+        ScopedPhase phase(renderProfile, "GUI", false);
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      }
+      {
+        ScopedPhase phase(renderProfile, "Swap", false);
+        glfwSwapBuffers(window);
+      }
       glfwPollEvents();
     }
 
+    simThread.stop(); // also ends a trace recording
     glDeleteProgram(shader);
     glfwTerminate();
   }
@@ -0,0 +1,111 @@
+#include "pixel_buffer.hh"
+
+#include <cstring>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void(APIENTRYP PFNBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size,
+                                             const void *data,
+                                             GLbitfield flags);
+static PFNBUFFERSTORAGEPROC bufferStorage = nullptr;
+
+bool loadBufferStorage(GLADloadproc load) {
+  bool supported = GLVersion.major > 4 ||
+                   (GLVersion.major == 4 && GLVersion.minor >= 4);
+  if (!supported) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint k = 0; k < count && !supported; k++) {
+      const char *ext =
+          reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, k));
+      supported = ext && std::strcmp(ext, "GL_ARB_buffer_storage") == 0;
+    }
+  }
+  if (supported)
+    bufferStorage = (PFNBUFFERSTORAGEPROC)load("glBufferStorage");
+  return bufferStorage != nullptr;
+}
+
+PixelBufferRing::~PixelBufferRing() { release(); }
+
+void PixelBufferRing::release() {
+  if (!size)
+    return;
+  for (int k = 0; k < SLOTS; k++) {
+    if (fences[k])
+      glDeleteSync(fences[k]);
+    if (mapped[k]) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[k]);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    fences[k] = nullptr;
+    mapped[k] = nullptr;
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glDeleteBuffers(SLOTS, buffers);
+  size = 0;
+  slot = 0;
+}
+
+void PixelBufferRing::create(size_t bytes) {
+  release();
+  size = bytes;
+  glGenBuffers(SLOTS, buffers);
+
+  for (int k = 0; k < SLOTS; k++) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[k]);
+    if (bufferStorage) {
+      const GLbitfield flags =
+          GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+      mapped[k] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    } else {
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void *PixelBufferRing::beginWrite() {
+  // Wait until the transfer that last used this slot has consumed it
+  if (fences[slot]) {
+    while (glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                            1000000) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fences[slot]);
+    fences[slot] = nullptr;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[slot]);
+  if (mapped[slot])
+    return mapped[slot];
+  return glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+                              GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void PixelBufferRing::endWrite() {
+  if (!mapped[slot])
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+void PixelBufferRing::upload(GLuint texture, int width, int height,
+                             GLenum format, GLenum type, const void *data) {
+  void *dst = beginWrite();
+  std::memcpy(dst, data, size);
+  endWrite();
+
+  // Source offset 0 into the bound unpack buffer
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type,
+                  nullptr);
+  fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  slot = (slot + 1) % SLOTS;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include "glad.h"
+
+// Ring of pixel unpack buffers used to stream texture updates.
+//
+// upload() copies the host data into the next buffer of the ring and issues
+// glTexSubImage2D from it, so the driver performs the texture transfer
+// asynchronously instead of blocking on a copy from client memory. Each
+// slot is guarded by a fence and only rewritten once the GPU is done with it.
+//
+// Buffers are persistently mapped when glBufferStorage is available
+// (GL 4.4 / ARB_buffer_storage, see loadBufferStorage). Otherwise each
+// upload maps the slot with GL_MAP_UNSYNCHRONIZED_BIT, which only needs
+// GL 3.3 core and works on Mesa's software rasterizers.
+class PixelBufferRing {
+public:
+  static const int SLOTS = 3;
+
+  PixelBufferRing() = default;
+  ~PixelBufferRing();
+  PixelBufferRing(const PixelBufferRing &) = delete;
+  PixelBufferRing &operator=(const PixelBufferRing &) = delete;
+
+  // (Re)allocate the ring for textures of `bytes` bytes
+  void create(size_t bytes);
+
+  // Stream `data` (slotBytes() bytes) into `texture`. Rows are tightly
+  // packed, so GL_UNPACK_ALIGNMENT must be 1 (the Renderer sets it)
+  void upload(GLuint texture, int width, int height, GLenum format,
+              GLenum type, const void *data);
+
+  size_t slotBytes() const { return size; }
+  bool persistent() const { return mapped[0] != nullptr; }
+
+private:
+  void release();
+  void *beginWrite();
+  void endWrite();
+
+  GLuint buffers[SLOTS] = {};
+  GLsync fences[SLOTS] = {};
+  void *mapped[SLOTS] = {};
+  size_t size = 0;
+  int slot = 0;
+};
+
+// Resolve glBufferStorage through the context's loader if the driver has it.
+// Must be called after gladLoadGLLoader and before PixelBufferRing::create.
+bool loadBufferStorage(GLADloadproc load);
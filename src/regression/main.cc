@@ -0,0 +1,350 @@
+// Regression check: runs the canonical scenarios for a fixed number of
+// steps and compares the final fields and the time per step against
+// stored baselines.
+//
+//   efsim_regression [--record] [--goldens DIR] [--scenario NAME]
+//                    [--steps N] [--tolerance T] [--slowdown X]
+//                    [--no-timing] [--kokkos-...]
+//
+// --record rewrites the goldens instead of checking them. Fields are
+// compared by relative L2 error (density, pressure, u, v); any NaN fails.
+// Timing baselines are the median fenced step time and only mean
+// something on the machine and backend that recorded them, so keep them
+// out of version control or pass --no-timing elsewhere.
+//
+// Exit status: 0 pass, 1 regression, 2 usage error or missing golden. No
+// goldens are checked in: record them once on a known-good build. A
+// missing golden fails before anything runs; a missing timing baseline is
+// reported but does not fail the check.
+#include <Kokkos_Core.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "efsim/efsim.hh"
+
+namespace fs = std::filesystem;
+
+struct Options {
+  bool record = false;
+  bool timing = true;
+  std::string goldens = "goldens";
+  std::vector<Scenario> scenarios = {Scenario::Cylinder, Scenario::Airfoil,
+                                     Scenario::Empty};
+  long steps = 200;
+  double tolerance = 1e-3; // relative L2 per field
+  double slowdown = 1.2;   // allowed median step time / baseline
+};
+
+// A named 2D field, row-major, as read from or written to a golden file
+struct Field {
+  char name[16] = {};
+  int32_t rows = 0, cols = 0;
+  std::vector<float> data;
+};
+
+// From the device view: solve_pressure swaps pressure's d_view only, so
+// after sync_host the host view can be the other buffer on host backends
+template <typename View> static Field capture(const char *name, View d) {
+  auto h = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), d);
+  Field f;
+  std::strncpy(f.name, name, sizeof(f.name) - 1);
+  f.rows = h.extent(0);
+  f.cols = h.extent(1);
+  f.data.reserve(size_t(f.rows) * f.cols);
+  for (int j = 0; j < f.rows; j++)
+    for (int i = 0; i < f.cols; i++)
+      f.data.push_back(h(j, i));
+  return f;
+}
+
+static std::vector<Field> capture(Sim &sim) {
+  return {capture("density", sim.density.field.d_view),
+          capture("pressure", sim.mac.pressure.d_view),
+          capture("u", sim.mac.xgrid.d_view),
+          capture("v", sim.mac.ygrid.d_view)};
+}
+
+// "EFG1", field count, then per field: name[16], rows, cols, float32 data
+static const char MAGIC[4] = {'E', 'F', 'G', '1'};
+
+static bool writeGolden(const fs::path &path,
+                        const std::vector<Field> &fields) {
+  std::ofstream file(path, std::ios::binary);
+  int32_t count = fields.size();
+  file.write(MAGIC, sizeof(MAGIC));
+  file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  for (const Field &f : fields) {
+    file.write(f.name, sizeof(f.name));
+    file.write(reinterpret_cast<const char *>(&f.rows), sizeof(f.rows));
+    file.write(reinterpret_cast<const char *>(&f.cols), sizeof(f.cols));
+    file.write(reinterpret_cast<const char *>(f.data.data()),
+               f.data.size() * sizeof(float));
+  }
+  return bool(file);
+}
+
+static bool readGolden(const fs::path &path, std::vector<Field> &fields) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[4];
+  int32_t count = 0;
+  if (!file.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      !file.read(reinterpret_cast<char *>(&count), sizeof(count)))
+    return false;
+  fields.resize(std::max(count, 0));
+  for (Field &f : fields) {
+    file.read(f.name, sizeof(f.name));
+    file.read(reinterpret_cast<char *>(&f.rows), sizeof(f.rows));
+    file.read(reinterpret_cast<char *>(&f.cols), sizeof(f.cols));
+    if (!file || f.rows < 0 || f.cols < 0)
+      return false;
+    f.name[sizeof(f.name) - 1] = '\0';
+    f.data.resize(size_t(f.rows) * f.cols);
+    file.read(reinterpret_cast<char *>(f.data.data()),
+              f.data.size() * sizeof(float));
+  }
+  return bool(file);
+}
+
+// Relative L2 error of `got` against `want`; infinity on NaN or a shape
+// mismatch
+static double relativeL2(const Field &got, const Field &want,
+                         double &maxAbs) {
+  maxAbs = 0.0;
+  if (got.rows != want.rows || got.cols != want.cols)
+    return INFINITY;
+  double err = 0.0, norm = 0.0;
+  for (size_t k = 0; k < got.data.size(); k++) {
+    double a = got.data[k], b = want.data[k];
+    if (std::isnan(a))
+      return INFINITY;
+    err += (a - b) * (a - b);
+    norm += b * b;
+    maxAbs = std::max(maxAbs, std::abs(a - b));
+  }
+  return norm > 0.0 ? std::sqrt(err / norm) : std::sqrt(err);
+}
+
+static fs::path goldenPath(const Options &opts, Scenario scenario) {
+  return fs::path(opts.goldens) /
+         (std::string(scenario_name(scenario)) + "_" + std::to_string(WIDTH) +
+          "x" + std::to_string(HEIGHT) + ".efg");
+}
+
+// Baselines for this grid size: one `scenario ms_per_step` per line
+static fs::path timingPath(const Options &opts) {
+  return fs::path(opts.goldens) / ("timing_" + std::to_string(WIDTH) + "x" +
+                                   std::to_string(HEIGHT) + ".txt");
+}
+
+static std::map<std::string, double> readTimings(const fs::path &path) {
+  std::map<std::string, double> timings;
+  std::ifstream file(path);
+  std::string name;
+  double ms;
+  while (file >> name >> ms)
+    timings[name] = ms;
+  return timings;
+}
+
+static bool applyOption(Options &opts, const std::string &key,
+                        const std::string &value, bool &scenarioGiven) {
+  if (key == "--goldens") {
+    opts.goldens = value;
+  } else if (key == "--steps") {
+    opts.steps = std::stol(value);
+  } else if (key == "--tolerance") {
+    opts.tolerance = std::stod(value);
+  } else if (key == "--slowdown") {
+    opts.slowdown = std::stod(value);
+  } else if (key == "--scenario") {
+    Scenario s;
+    if (!parse_scenario(value, s))
+      return false;
+    if (!scenarioGiven)
+      opts.scenarios.clear();
+    scenarioGiven = true;
+    opts.scenarios.push_back(s);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Apply one option; false if the key is unknown or the value malformed
+static bool setOption(Options &opts, const std::string &key,
+                      const std::string &value, bool &scenarioGiven) {
+  try {
+    return applyOption(opts, key, value, scenarioGiven);
+  } catch (const std::invalid_argument &) {
+    return false;
+  } catch (const std::out_of_range &) {
+    return false;
+  }
+}
+
+static bool parseArgs(Options &opts, int argc, char *argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  bool scenarioGiven = false;
+  for (size_t k = 0; k < args.size(); k++) {
+    const std::string &a = args[k];
+    if (a == "--record") {
+      opts.record = true;
+      continue;
+    }
+    if (a == "--no-timing") {
+      opts.timing = false;
+      continue;
+    }
+    if (k + 1 >= args.size() ||
+        !setOption(opts, a, args[k + 1], scenarioGiven)) {
+      std::cerr << "Bad option " << a << "\n";
+      return false;
+    }
+    k++;
+  }
+  return true;
+}
+
+// Solid cells inside the domain boundary
+static long interiorSolids(Sim &sim) {
+  sim.mac.sync_host();
+  auto s = sim.mac.sgrid.h_view;
+  long n = 0;
+  for (int j = 2; j < HEIGHT; j++)
+    for (int i = 1; i <= WIDTH; i++)
+      n += s(j, i) == 0;
+  return n;
+}
+
+// Runs one scenario; returns the median fenced step time in ms
+static double run(Sim &sim, const Options &opts, const SimParams &params) {
+  std::vector<double> times;
+  times.reserve(opts.steps);
+  for (long step = 0; step < opts.steps; step++) {
+    Kokkos::Timer timer;
+    sim.step(params.dt, params);
+    Kokkos::fence();
+    times.push_back(timer.seconds() * 1e3);
+  }
+  if (times.empty())
+    return 0.0;
+  std::nth_element(times.begin(), times.begin() + times.size() / 2,
+                   times.end());
+  return times[times.size() / 2];
+}
+
+int main(int argc, char *argv[]) {
+  Kokkos::initialize(argc, argv);
+  int status = 0;
+  {
+    Options opts;
+    if (!parseArgs(opts, argc, argv)) {
+      Kokkos::finalize();
+      return 2;
+    }
+    if (opts.record) {
+      fs::create_directories(opts.goldens);
+    } else {
+      // Without goldens there is nothing to check: say so up front rather
+      // than after running every scenario
+      bool missing = false;
+      for (Scenario scenario : opts.scenarios)
+        if (!fs::exists(goldenPath(opts, scenario))) {
+          std::cerr << "Missing golden " << goldenPath(opts, scenario)
+                    << "\n";
+          missing = true;
+        }
+      if (missing) {
+        std::cerr << "Record the goldens with --record --goldens "
+                  << opts.goldens << " on a known-good build\n";
+        Kokkos::finalize();
+        return 2;
+      }
+    }
+    std::map<std::string, double> timings = readTimings(timingPath(opts));
+
+    // Fixed parameters: changing them invalidates every golden
+    SimParams params;
+
+    for (Scenario scenario : opts.scenarios) {
+      const std::string name = scenario_name(scenario);
+      const fs::path golden = goldenPath(opts, scenario);
+
+      Sim sim(scenario);
+      // An obstacle that misses the grid would make the golden an empty
+      // channel and leave the wall boundary conditions untested
+      if (scenario != Scenario::Empty && interiorSolids(sim) == 0) {
+        std::cerr << name << " has no solid cells at " << WIDTH << "x"
+                  << HEIGHT << "\n";
+        status = std::max(status, 2);
+        continue;
+      }
+      double ms = run(sim, opts, params);
+      std::vector<Field> fields = capture(sim);
+
+      if (opts.record) {
+        if (!writeGolden(golden, fields)) {
+          std::cerr << "Cannot write " << golden << "\n";
+          status = 2;
+        }
+        timings[name] = ms;
+        std::printf("%-10s recorded  %.3f ms/step\n", name.c_str(), ms);
+        continue;
+      }
+
+      std::vector<Field> want;
+      if (!readGolden(golden, want)) {
+        std::cerr << "Missing or unreadable golden " << golden
+                  << "; run with --record first\n";
+        status = std::max(status, 2);
+        continue;
+      }
+      for (const Field &f : fields) {
+        auto w = std::find_if(want.begin(), want.end(), [&](const Field &g) {
+          return std::strcmp(g.name, f.name) == 0;
+        });
+        double maxAbs = 0.0;
+        double err = w == want.end() ? INFINITY : relativeL2(f, *w, maxAbs);
+        bool ok = err <= opts.tolerance;
+        std::printf("%-10s %-9s rel_l2=%.3e max_abs=%.3e %s\n", name.c_str(),
+                    f.name, err, maxAbs, ok ? "ok" : "FAIL");
+        if (!ok)
+          status = std::max(status, 1);
+      }
+
+      if (!opts.timing)
+        continue;
+      auto base = timings.find(name);
+      if (base == timings.end() || base->second <= 0.0) {
+        std::printf("%-10s timing    %.3f ms/step, no baseline\n",
+                    name.c_str(), ms);
+        continue;
+      }
+      double ratio = ms / base->second;
+      bool ok = ratio <= opts.slowdown;
+      std::printf("%-10s timing    %.3f ms/step vs %.3f (x%.2f) %s\n",
+                  name.c_str(), ms, base->second, ratio, ok ? "ok" : "FAIL");
+      if (!ok)
+        status = std::max(status, 1);
+    }
+
+    if (opts.record) {
+      std::ofstream file(timingPath(opts));
+      for (const auto &t : timings)
+        file << t.first << " " << t.second << "\n";
+    }
+  }
+  Kokkos::finalize();
+  return status;
+}
@@ -1,12 +1,14 @@
 #include "renderer.hh"
 
 #include <Kokkos_DualView.hpp>
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <vector>
 
+#include "efsim/trace.hh"
 #include "glad.h"
 
 Renderer::Renderer(std::vector<Vertex> data, size_t count) {
@@ -32,6 +34,10 @@ Renderer::Renderer(std::vector<Vertex> data, size_t count) {
   glEnableVertexAttribArray(0);
 
   glBindVertexArray(0);
+
+  // Every texture upload has tightly packed rows, and rows of 8-bit texels
+  // are not 4-byte aligned in general. Set once rather than per upload.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 }
 
 void Renderer::draw(GLuint shader) {
@@ -39,7 +45,7 @@ void Renderer::draw(GLuint shader) {
 
   // Density (unit 0)
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, densityTexture);
+  glBindTexture(GL_TEXTURE_2D, density.id);
   glUniform1i(glGetUniformLocation(shader, "uDensity"), 0);
 
   // Obstacle (unit 1)
@@ -49,9 +55,14 @@ void Renderer::draw(GLuint shader) {
 
   // Pressure (unit 2)
   glActiveTexture(GL_TEXTURE2);
-  glBindTexture(GL_TEXTURE_2D, pressureTexture);
+  glBindTexture(GL_TEXTURE_2D, pressure.id);
   glUniform1i(glGetUniformLocation(shader, "uPressure"), 2);
 
+  // Derived field (unit 3)
+  glActiveTexture(GL_TEXTURE3);
+  glBindTexture(GL_TEXTURE_2D, derived.id);
+  glUniform1i(glGetUniformLocation(shader, "uDerived"), 3);
+
   glDrawArrays(GL_TRIANGLE_FAN, 0, vertex_count);
   glBindVertexArray(0);
 }
@@ -60,43 +71,77 @@ Renderer::~Renderer() {
   glDeleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &VBO);
   glDeleteBuffers(1, &EBO);
-  glDeleteTextures(1, &densityTexture);
+  glDeleteTextures(1, &density.id);
   glDeleteTextures(1, &obstacleTexture);
-  glDeleteTextures(1, &pressureTexture);
+  glDeleteTextures(1, &pressure.id);
+  glDeleteTextures(1, &derived.id);
 }
 
-void Renderer::createPressureTexture(int width, int height,
-                                     float *pressureData) {
-  glGenTextures(1, &pressureTexture);
-  glBindTexture(GL_TEXTURE_2D, pressureTexture);
+// Texture internal format and upload pixel type for a display format
+static void glFormat(DisplayFormat format, GLint &internal, GLenum &type) {
+  switch (format) {
+  case DisplayFormat::Half:
+    internal = GL_R16F;
+    type = GL_HALF_FLOAT;
+    break;
+  case DisplayFormat::UNorm8:
+    internal = GL_R8;
+    type = GL_UNSIGNED_BYTE;
+    break;
+  default:
+    internal = GL_R32F;
+    type = GL_FLOAT;
+  }
+}
+
+void Renderer::createField(FieldTexture &field, int width, int height,
+                           DisplayFormat format) {
+  glGenTextures(1, &field.id);
+  glBindTexture(GL_TEXTURE_2D, field.id);
 
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT,
-               pressureData);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  resizeField(field, width, height, format);
+}
 
+void Renderer::resizeField(FieldTexture &field, int width, int height,
+                           DisplayFormat format) {
+  field.width = width;
+  field.height = height;
+  field.format = format;
+
+  // Contents arrive with the next snapshot
+  GLint internal;
+  GLenum type;
+  glFormat(format, internal, type);
+  glBindTexture(GL_TEXTURE_2D, field.id);
+  glTexImage2D(GL_TEXTURE_2D, 0, internal, width, height, 0, GL_RED, type,
+               nullptr);
   glBindTexture(GL_TEXTURE_2D, 0);
+  field.upload.create(size_t(width) * height * texel_bytes(format));
 }
 
-void Renderer::createDensityTexture(int width, int height, float *densityData) {
+void Renderer::createDensityTexture(int width, int height,
+                                    DisplayFormat format) {
   gridWidth = width;
   gridHeight = height;
+  createField(density, width, height, format);
+}
 
-  glGenTextures(1, &densityTexture);
-  glBindTexture(GL_TEXTURE_2D, densityTexture);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, gridWidth, gridHeight, 0, GL_RED,
-               GL_FLOAT, densityData);
+// Normalized to [0,1] on device
+void Renderer::createPressureTexture(int width, int height,
+                                     DisplayFormat format) {
+  createField(pressure, width, height, format);
+}
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+// Normalized to [0,1] on device, signed fields centred on 0.5
+void Renderer::createDerivedTexture(int width, int height,
+                                    DisplayFormat format) {
+  createField(derived, width, height, format);
 }
 
 void Renderer::createObstacleTexture(int width, int height, int *obstacleData) {
@@ -115,57 +160,76 @@ void Renderer::createObstacleTexture(int width, int height, int *obstacleData) {
   glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void Renderer::updateDensity(Kokkos::DualView<float **> &field) {
-  field.sync_host();
-  glBindTexture(GL_TEXTURE_2D, densityTexture);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, gridWidth, gridHeight, GL_RED,
-                  GL_FLOAT, field.h_view.data());
-}
-
-void Renderer::updatePressure(Kokkos::DualView<float **> &pressure) {
-    pressure.sync_host();
+void Renderer::uploadField(FieldTexture &field, const void *data,
+                           DisplayFormat format, int width, int height) {
+  if (format != field.format || width != field.width ||
+      height != field.height)
+    resizeField(field, width, height, format);
 
-    // Find min/max on host
-    float minP = pressure.h_view(0,0);
-    float maxP = pressure.h_view(0,0);
-    for (int j = 0; j < gridHeight; ++j) {
-        for (int i = 0; i < gridWidth; ++i) {
-            float v = pressure.h_view(j, i);
-            if (v < minP) minP = v;
-            if (v > maxP) maxP = v;
-        }
-    }
+  GLint internal;
+  GLenum type;
+  glFormat(format, internal, type);
+  field.upload.upload(field.id, width, height, GL_RED, type, data);
+}
 
-    float range = maxP - minP;
-    if (range < 1e-6f) range = 1.0f; // avoid divide by zero
+void Renderer::updateDensity(const void *densityData, DisplayFormat format,
+                             int width, int height) {
+  TraceScope trace("Renderer::updateDensity");
+  uploadField(density, densityData, format, width, height);
+}
 
-    // Create normalized buffer
-    std::vector<float> normalized(gridWidth * gridHeight);
-    for (int j = 0; j < gridHeight; ++j) {
-        for (int i = 0; i < gridWidth; ++i) {
-            normalized[j + gridWidth * i] = (pressure.h_view(j, i) - minP) / range * 2.0f - 1.0f;
-            // normalized to [-1,1]
-        }
-    }
+void Renderer::updatePressure(const void *pressureData, DisplayFormat format,
+                              int width, int height) {
+  TraceScope trace("Renderer::updatePressure");
+  uploadField(pressure, pressureData, format, width, height);
+}
 
-    glBindTexture(GL_TEXTURE_2D, pressureTexture);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, gridWidth, gridHeight, GL_RED,
-                    GL_FLOAT, normalized.data());
+void Renderer::updateDerived(const void *derivedData, DisplayFormat format,
+                             int width, int height) {
+  TraceScope trace("Renderer::updateDerived");
+  uploadField(derived, derivedData, format, width, height);
 }
 
 void Renderer::updateObstacle(Kokkos::DualView<int **> &obs) {
+  TraceScope trace("Renderer::updateObstacle");
   obs.sync_host();
 
-  std::vector<int> hostBuffer(gridWidth * gridHeight);
+  obstacleHost.resize(gridWidth * gridHeight);
   for (int j = 0; j < gridHeight; j++) {
     for (int i = 0; i < gridWidth; i++) {
-      hostBuffer[j * gridWidth + i] = obs.h_view(i, j);
+      obstacleHost[j * gridWidth + i] = obs.h_view(i, j);
     }
   }
 
   glBindTexture(GL_TEXTURE_2D, obstacleTexture);
   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, gridWidth, gridHeight, GL_RED_INTEGER,
-                  GL_INT, hostBuffer.data());
+                  GL_INT, obstacleHost.data());
+}
+
+void Renderer::updateObstacleBrush(const Brush &brush) {
+  TraceScope trace("Renderer::updateObstacleBrush");
+  int i0, j0, i1, j1;
+  brush.bounds(i0, j0, i1, j1);
+  if (i0 > i1 || j0 > j1)
+    return;
+  for (int i = i0; i <= i1; i++)
+    for (int j = j0; j <= j1; j++)
+      if (brush.covers(i, j))
+        obstacleHost[(i + 1) * gridWidth + j + 1] = brush.value;
+  uploadObstacleRect(j0 + 1, i0 + 1, j1 + 1, i1 + 1);
+}
+
+// Upload texels [x0, x1] x [y0, y1] straight out of the full host copy
+void Renderer::uploadObstacleRect(int x0, int y0, int x1, int y1) {
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, gridWidth);
+  glPixelStorei(GL_UNPACK_SKIP_PIXELS, x0);
+  glPixelStorei(GL_UNPACK_SKIP_ROWS, y0);
+  glBindTexture(GL_TEXTURE_2D, obstacleTexture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0 + 1, y1 - y0 + 1,
+                  GL_RED_INTEGER, GL_INT, obstacleHost.data());
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+  glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
 }
 
 unsigned int make_module(const std::string &filepath,
@@ -4,6 +4,8 @@
 #include <cstddef>
 #include <string>
 #include <vector>
+#include "efsim/display.hh"
+#include "pixel_buffer.hh"
 #include "vertex.hh"
 
 class Renderer {
@@ -15,13 +17,23 @@ public:
   void draw(GLuint shader);
 
   // Create / update textures
-  void createDensityTexture(int width, int height, float *densityData);
+  void createDensityTexture(int width, int height, DisplayFormat format);
   void createObstacleTexture(int width, int height, int *obstacleData);
-  void createPressureTexture(int width, int height, float *pressureData);
-  void updateDensity(Kokkos::DualView<float **> &field);
+  void createPressureTexture(int width, int height, DisplayFormat format);
+  void createDerivedTexture(int width, int height, DisplayFormat format);
+  // Field textures follow the size of the data, which may be a reduced
+  // level of detail of the grid
+  void updateDensity(const void *densityData, DisplayFormat format, int width,
+                     int height);
   void updateObstacle(Kokkos::DualView<int **> &obs);
+  // Rasterize a brush stroke into the obstacle texture, as Mac::paint does
+  // on device
+  void updateObstacleBrush(const Brush &brush);
 
-  void updatePressure(Kokkos::DualView<float **> &pressure);
+  void updatePressure(const void *pressureData, DisplayFormat format,
+                      int width, int height);
+  void updateDerived(const void *derivedData, DisplayFormat format, int width,
+                     int height);
 
   // Compile and link shaders
   unsigned int make_shader(const std::string &vertex_filepath,
@@ -30,13 +42,32 @@ public:
   GLuint obstacleTexture;
 
 private:
+  // A streamed single-channel display texture
+  struct FieldTexture {
+    GLuint id = 0;
+    DisplayFormat format = DisplayFormat::Float32;
+    int width = 0;
+    int height = 0;
+    PixelBufferRing upload;
+  };
+
+  void createField(FieldTexture &field, int width, int height,
+                   DisplayFormat format);
+  void resizeField(FieldTexture &field, int width, int height,
+                   DisplayFormat format);
+  void uploadField(FieldTexture &field, const void *data, DisplayFormat format,
+                   int width, int height);
+  void uploadObstacleRect(int x0, int y0, int x1, int y1);
+
   GLuint VAO, VBO, EBO;
-  GLuint densityTexture;
-  GLuint pressureTexture;
+  FieldTexture density;
+  FieldTexture pressure;
+  FieldTexture derived;
 
   size_t vertex_count;
   int gridWidth;
   int gridHeight;
+  std::vector<int> obstacleHost; // texture layout, kept by updateObstacle
 };
 
 // Standalone helper for compiling shader modules
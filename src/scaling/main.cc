@@ -0,0 +1,308 @@
+// Scaling study: runs sim_headless_<size> (see EFSIM_SCALING_SIZES in
+// CMakeLists.txt) over thread counts, grid sizes and pressure solvers and
+// writes a CSV and a JSON report.
+//
+//   efsim_scaling [--bin-dir DIR] [--out DIR] [--threads 1,2,4,8]
+//                 [--sizes 256,512,1024] [--solvers jacobi,rbgs]
+//                 [--steps N] [--repeat R] [--weak]
+//
+// Strong scaling (default) runs every size at every thread count. Weak
+// scaling (--weak) pairs the k-th size with the k-th thread count, so
+// pick sizes that keep the cells per thread constant (e.g. 512,724,1024
+// with 1,2,4). For thread-based backends only (OpenMP, Threads).
+//
+// Speedup is throughput (cells per second) relative to the first thread
+// count of a series; parallel efficiency is speedup divided by the thread
+// ratio, which is the usual T1 / (p Tp) for strong scaling and T1 / Tp
+// scaled by the work ratio for weak scaling. Of R repeats the fastest is
+// kept.
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Options {
+  std::string binDir = ".";
+  std::string out = "scaling";
+  std::vector<int> threads = {1, 2, 4, 8};
+  std::vector<int> sizes = {256, 512, 1024};
+  std::vector<std::string> solvers = {"jacobi", "rbgs"};
+  long steps = 200;
+  int repeat = 3;
+  bool weak = false;
+};
+
+// One sim_headless run, from its summary and --profile lines
+struct Result {
+  int size = 0;
+  std::string solver;
+  int threads = 0;
+  double msPerStep = 0.0;
+  double mcellsPerS = 0.0;
+  double memoryMb = 0.0;
+  double maxRssMb = 0.0;
+  std::map<std::string, double> phaseMs; // mean per step
+  double speedup = 0.0;
+  double efficiency = 0.0;
+};
+
+static std::vector<std::string> split(const std::string &s, char sep) {
+  std::vector<std::string> parts;
+  std::istringstream in(s);
+  std::string part;
+  while (std::getline(in, part, sep))
+    if (!part.empty())
+      parts.push_back(part);
+  return parts;
+}
+
+static std::vector<int> splitInts(const std::string &s) {
+  std::vector<int> values;
+  for (const std::string &p : split(s, ','))
+    values.push_back(std::stoi(p));
+  return values;
+}
+
+static bool applyOption(Options &opts, const std::string &key,
+                        const std::string &value) {
+  if (key == "--bin-dir")
+    opts.binDir = value;
+  else if (key == "--out")
+    opts.out = value;
+  else if (key == "--threads")
+    opts.threads = splitInts(value);
+  else if (key == "--sizes")
+    opts.sizes = splitInts(value);
+  else if (key == "--solvers")
+    opts.solvers = split(value, ',');
+  else if (key == "--steps")
+    opts.steps = std::stol(value);
+  else if (key == "--repeat")
+    opts.repeat = std::max(1, std::stoi(value));
+  else
+    return false;
+  return true;
+}
+
+// Apply one option; false if the key is unknown or the value malformed
+static bool setOption(Options &opts, const std::string &key,
+                      const std::string &value) {
+  try {
+    return applyOption(opts, key, value);
+  } catch (const std::invalid_argument &) {
+    return false;
+  } catch (const std::out_of_range &) {
+    return false;
+  }
+}
+
+static bool parseArgs(Options &opts, int argc, char *argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  for (size_t k = 0; k < args.size(); k++) {
+    const std::string &a = args[k];
+    if (a == "--weak") {
+      opts.weak = true;
+      continue;
+    }
+    if (k + 1 >= args.size() || !setOption(opts, a, args[k + 1])) {
+      std::cerr << "Bad option " << a << "\n";
+      return false;
+    }
+    k++;
+  }
+  if (opts.weak && opts.sizes.size() != opts.threads.size()) {
+    std::cerr << "--weak needs as many sizes as thread counts\n";
+    return false;
+  }
+  return !opts.threads.empty() && !opts.sizes.empty() &&
+         !opts.solvers.empty();
+}
+
+// `key=value` tokens of one line
+static std::map<std::string, std::string> fields(const std::string &line) {
+  std::map<std::string, std::string> kv;
+  std::istringstream in(line);
+  std::string token;
+  while (in >> token) {
+    auto eq = token.find('=');
+    if (eq != std::string::npos)
+      kv[token.substr(0, eq)] = token.substr(eq + 1);
+  }
+  return kv;
+}
+
+static double number(const std::map<std::string, std::string> &kv,
+                     const char *key) {
+  auto it = kv.find(key);
+  return it == kv.end() ? 0.0 : std::stod(it->second);
+}
+
+static bool runOnce(const Options &opts, int size, const std::string &solver,
+                    int threads, Result &result) {
+  fs::path exe = fs::path(opts.binDir) / ("sim_headless_" +
+                                          std::to_string(size));
+  fs::path runDir = fs::path(opts.out) / "runs" /
+                    (std::to_string(size) + "_" + solver + "_" +
+                     std::to_string(threads));
+  fs::create_directories(runDir);
+  std::string cmd = "\"" + exe.string() + "\" --steps " +
+                    std::to_string(opts.steps) + " --solver " + solver +
+                    " --profile --out \"" + runDir.string() +
+                    "\" --kokkos-num-threads=" + std::to_string(threads);
+
+  FILE *pipe = popen(cmd.c_str(), "r");
+  if (!pipe) {
+    std::cerr << "Cannot run " << cmd << "\n";
+    return false;
+  }
+  result = Result{};
+  result.size = size;
+  result.solver = solver;
+  result.threads = threads;
+  bool summary = false, malformed = false;
+  char buffer[512];
+  while (std::fgets(buffer, sizeof(buffer), pipe)) {
+    auto kv = fields(buffer);
+    try {
+      if (kv.count("ms_per_step")) {
+        result.msPerStep = number(kv, "ms_per_step");
+        result.mcellsPerS = number(kv, "mcells_per_s");
+        result.memoryMb = number(kv, "memory_mb");
+        result.maxRssMb = number(kv, "max_rss_mb");
+        summary = true;
+      } else if (kv.count("phase")) {
+        result.phaseMs[kv["phase"]] = number(kv, "mean_ms");
+      }
+    } catch (const std::logic_error &) {
+      // invalid_argument or out_of_range from stod
+      std::cerr << "Unexpected output line: " << buffer;
+      malformed = true;
+    }
+  }
+  if (pclose(pipe) != 0 || !summary || malformed) {
+    std::cerr << "Failed: " << cmd << "\n";
+    return false;
+  }
+  return true;
+}
+
+// Fastest of opts.repeat runs
+static bool run(const Options &opts, int size, const std::string &solver,
+                int threads, Result &best) {
+  bool any = false;
+  for (int r = 0; r < opts.repeat; r++) {
+    Result result;
+    if (!runOnce(opts, size, solver, threads, result))
+      continue;
+    if (!any || result.msPerStep < best.msPerStep)
+      best = result;
+    any = true;
+  }
+  if (any)
+    std::printf("size=%d solver=%s threads=%d ms_per_step=%.3f\n", size,
+                solver.c_str(), threads, best.msPerStep);
+  return any;
+}
+
+// Speedup and efficiency of each run against the first of its series
+static void scale(std::vector<Result> &series) {
+  if (series.empty() || series[0].mcellsPerS <= 0.0)
+    return;
+  const Result &base = series[0];
+  for (Result &r : series) {
+    r.speedup = r.mcellsPerS / base.mcellsPerS;
+    r.efficiency = r.speedup * base.threads / r.threads;
+  }
+}
+
+static void writeCsv(const fs::path &path, const std::vector<Result> &results,
+                     const std::vector<std::string> &phases) {
+  std::ofstream csv(path);
+  csv << "size,solver,threads,ms_per_step,mcells_per_s,speedup,efficiency,"
+         "memory_mb,max_rss_mb";
+  for (const std::string &p : phases)
+    csv << "," << p << "_ms";
+  csv << "\n";
+  for (const Result &r : results) {
+    csv << r.size << "," << r.solver << "," << r.threads << ","
+        << r.msPerStep << "," << r.mcellsPerS << "," << r.speedup << ","
+        << r.efficiency << "," << r.memoryMb << "," << r.maxRssMb;
+    for (const std::string &p : phases) {
+      auto it = r.phaseMs.find(p);
+      csv << ",";
+      if (it != r.phaseMs.end())
+        csv << it->second;
+    }
+    csv << "\n";
+  }
+}
+
+static void writeJson(const fs::path &path, const Options &opts,
+                      const std::vector<Result> &results) {
+  std::ofstream json(path);
+  json << "{\"mode\":\"" << (opts.weak ? "weak" : "strong")
+       << "\",\"steps\":" << opts.steps << ",\"runs\":[";
+  for (size_t k = 0; k < results.size(); k++) {
+    const Result &r = results[k];
+    json << (k ? ",\n" : "\n") << "{\"size\":" << r.size << ",\"solver\":\""
+         << r.solver << "\",\"threads\":" << r.threads
+         << ",\"ms_per_step\":" << r.msPerStep
+         << ",\"mcells_per_s\":" << r.mcellsPerS
+         << ",\"speedup\":" << r.speedup
+         << ",\"efficiency\":" << r.efficiency
+         << ",\"memory_mb\":" << r.memoryMb
+         << ",\"max_rss_mb\":" << r.maxRssMb << ",\"phases_ms\":{";
+    bool first = true;
+    for (const auto &p : r.phaseMs) {
+      json << (first ? "" : ",") << "\"" << p.first << "\":" << p.second;
+      first = false;
+    }
+    json << "}}";
+  }
+  json << "\n]}\n";
+}
+
+int main(int argc, char *argv[]) {
+  Options opts;
+  if (!parseArgs(opts, argc, argv))
+    return 2;
+  fs::create_directories(opts.out);
+
+  std::vector<Result> results;
+  int status = 0;
+  for (const std::string &solver : opts.solvers) {
+    // One series per size (strong) or a single series (weak)
+    size_t seriesCount = opts.weak ? 1 : opts.sizes.size();
+    for (size_t s = 0; s < seriesCount; s++) {
+      std::vector<Result> series;
+      for (size_t t = 0; t < opts.threads.size(); t++) {
+        int size = opts.weak ? opts.sizes[t] : opts.sizes[s];
+        Result r;
+        if (run(opts, size, solver, opts.threads[t], r))
+          series.push_back(r);
+        else
+          status = 1;
+      }
+      scale(series);
+      results.insert(results.end(), series.begin(), series.end());
+    }
+  }
+
+  std::vector<std::string> phases;
+  for (const Result &r : results)
+    for (const auto &p : r.phaseMs)
+      if (std::find(phases.begin(), phases.end(), p.first) == phases.end())
+        phases.push_back(p.first);
+
+  writeCsv(fs::path(opts.out) / "scaling.csv", results, phases);
+  writeJson(fs::path(opts.out) / "scaling.json", opts, results);
+  return status;
+}
@@ -5,6 +5,12 @@ out vec4 FragColor;
 uniform sampler2D uDensity;
 uniform sampler2D uPressure;
 uniform isampler2D uObstacle;
+uniform sampler2D uDerived;
+uniform bool uShowPressure;
+
+// 1 = density, 2 = vorticity, 3 = speed, 4 = divergence, 5 = Q-criterion,
+// 6 = line integral convolution
+uniform int uMode;
 
 // Map pressure [-1,1] to blue -> white -> red
 vec3 pressureColormap(float p) {
@@ -21,17 +27,33 @@ void main() {
         return;
     }
 
-    // Base density color (green)
-    float density = texture(uDensity, texCoord).r;
-    vec3 baseColor = mix(vec3(0.0), vec3(0.0, 1.0, 0.0), density);
+    vec3 baseColor;
+    if (uMode <= 1) {
+        // Base density color (green)
+        float density = texture(uDensity, texCoord).r;
+        baseColor = mix(vec3(0.0), vec3(0.0, 1.0, 0.0), density);
+    } else if (uMode == 6) {
+        // LIC: grey streaks, density tinted green on top
+        float lic = texture(uDerived, texCoord).r;
+        float density = texture(uDensity, texCoord).r;
+        baseColor = mix(vec3(lic), vec3(0.0, lic, 0.0), clamp(density, 0.0, 1.0));
+    } else if (uMode == 3) {
+        // Speed: black -> yellow
+        float speed = texture(uDerived, texCoord).r;
+        baseColor = mix(vec3(0.0), vec3(1.0, 0.85, 0.2), speed);
+    } else {
+        // Signed fields are centred on 0.5: blue -> black -> red
+        float f = texture(uDerived, texCoord).r * 2.0 - 1.0;
+        baseColor = f < 0.0 ? vec3(0.2, 0.4, 1.0) * -f : vec3(1.0, 0.3, 0.2) * f;
+    }
 
-    // Overlay pressure hotspots
-    float pressure = texture(uPressure, texCoord).r;
+    // Overlay pressure hotspots (normalized to [0,1] on device)
+    float pressure = texture(uPressure, texCoord).r * 2.0 - 1.0;
     vec3 pressureColor = vec3(0.0); // default no hotspot
     float threshold = 0.9;
-    // if (abs(pressure) > threshold) {
-    //     pressureColor = pressureColormap(pressure);
-    // }
+    if (uShowPressure && abs(pressure) > threshold) {
+        pressureColor = pressureColormap(pressure);
+    }
 
     // Blend pressure on top of density (simple max for visibility)
     vec3 finalColor = max(baseColor, pressureColor);
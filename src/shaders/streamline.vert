@@ -1,6 +1,16 @@
 #version 330 core
 layout(location=0) in vec2 vertexPos;
+
+// When set, vertexPos is a grid position and is placed like the
+// textures in default.frag
+uniform bool uGridCoords;
+uniform vec2 uGridSize;
+
 void main() {
-    gl_Position = vec4(vertexPos, 0.0, 1.0);
+    vec2 pos = vertexPos;
+    if (uGridCoords) {
+        vec2 tex = vertexPos / uGridSize;
+        pos = vec2(tex.x, 1.0 - tex.y) * 2.0 - 1.0;
+    }
+    gl_Position = vec4(pos, 0.0, 1.0);
 }
-
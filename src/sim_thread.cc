@@ -0,0 +1,309 @@
+#include "sim_thread.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "consts.hh"
+#include "efsim/trace.hh"
+
+Snapshot::Snapshot(int width, int height)
+    : density{HostBytes("Snapshot density", size_t(width) * height * 4)},
+      pressure{HostBytes("Snapshot pressure", size_t(width) * height * 4)},
+      derived{HostBytes("Snapshot derived", size_t(width) * height * 4)} {}
+
+SimThread::SimThread(Sim &sim)
+    : sim(sim), snapshots(WIDTH, HEIGHT),
+      stageDensity("Stage density", size_t(WIDTH) * HEIGHT * 4),
+      stagePressure("Stage pressure", size_t(WIDTH) * HEIGHT * 4),
+      stageDerived("Stage derived", size_t(WIDTH) * HEIGHT * 4),
+      derived("Derived", HEIGHT, WIDTH),
+      copySpace(Kokkos::Experimental::partition_space(
+          Kokkos::DefaultExecutionSpace(), 1)[0]) {}
+
+SimThread::~SimThread() { stop(); }
+
+void SimThread::start() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running)
+      return;
+    running = true;
+  }
+  worker = std::thread(&SimThread::run, this);
+}
+
+void SimThread::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+  }
+  resume.notify_one();
+  if (worker.joinable())
+    worker.join();
+}
+
+void SimThread::setParams(const ControlPanel &ctrlPanel) {
+  bool wake;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Trace toggles are handled by the sim thread, also while paused
+    wake = (params.pause && !ctrlPanel.pause) ||
+           params.recordTrace != ctrlPanel.recordTrace;
+    // Not the phase tables, which only the render thread reads
+    params = static_cast<const PanelSettings &>(ctrlPanel);
+  }
+  if (wake)
+    resume.notify_one();
+}
+
+void SimThread::paint(const std::vector<Brush> &brushes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pendingBrushes.insert(pendingBrushes.end(), brushes.begin(),
+                          brushes.end());
+  }
+  resume.notify_one();
+}
+
+// Trace::start/stop swap the global Kokkos Tools callbacks and the sim
+// thread is the one inside them, so recording is toggled here, between
+// frames, with no readback in flight
+void SimThread::setTracing(bool on) {
+  finishReadback();
+  if (on)
+    Trace::start();
+  else if (Trace::stop("efsim_trace.json"))
+    std::cout << "Wrote efsim_trace.json" << std::endl;
+}
+
+void SimThread::run() {
+  using clock = std::chrono::steady_clock;
+  Trace::nameThread("sim");
+
+  auto last = clock::now();
+  auto rateStart = last;
+  long rateSteps = 0;
+  double avgStep = 0.0; // running estimate of one Sim::step, in seconds
+  std::vector<Brush> brushes;
+
+  while (true) {
+    PanelSettings stepParams;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (running && params.pause) {
+        finishReadback();
+        sps.store(0.0f, std::memory_order_relaxed);
+        resume.wait(lock, [this] {
+          return !running || !params.pause || !pendingBrushes.empty() ||
+                 params.recordTrace != Trace::recording();
+        });
+        // Don't feed the paused interval into the next step
+        last = rateStart = clock::now();
+        rateSteps = 0;
+      }
+      if (!running) {
+        finishReadback();
+        if (Trace::recording())
+          setTracing(false);
+        break;
+      }
+      stepParams = params;
+      brushes.swap(pendingBrushes);
+    }
+
+    for (const Brush &brush : brushes)
+      sim.mac.paint(brush);
+    brushes.clear();
+    if (stepParams.recordTrace != Trace::recording())
+      setTracing(stepParams.recordTrace);
+    if (stepParams.pause)
+      continue;
+
+    if (sim.profile.enabled != stepParams.timePhases) {
+      sim.profile.enabled = profile.enabled = stepParams.timePhases;
+      sim.profile.clear();
+      profile.clear();
+    }
+
+    // Run as many steps as fit in the frame budget, then publish once.
+    // Each step ends in a fence of the default execution space instance,
+    // so the timers measure kernel time while the readback queued on
+    // copySpace keeps running.
+    double budget = stepParams.frameBudget * 1e-3;
+    Kokkos::Timer frameTimer;
+    int n = 0;
+    float frameTime = 0.0f; // simulated time covered by this frame
+    do {
+      auto now = clock::now();
+      float deltaTime = std::chrono::duration<float>(now - last).count();
+      last = now;
+      frameTime += deltaTime;
+
+      Kokkos::Timer stepTimer;
+      sim.step(deltaTime, stepParams);
+      ++steps;
+      double t = stepTimer.seconds();
+      avgStep = avgStep == 0.0 ? t : 0.9 * avgStep + 0.1 * t;
+      ++n;
+    } while (n < stepParams.maxSubsteps &&
+             frameTimer.seconds() + avgStep <= budget);
+
+    publish(stepParams, frameTime);
+    substeps.store(n, std::memory_order_relaxed);
+
+    rateSteps += n;
+    float elapsed =
+        std::chrono::duration<float>(clock::now() - rateStart).count();
+    if (elapsed >= 0.5f) {
+      sps.store(rateSteps / elapsed, std::memory_order_relaxed);
+      rateStart = clock::now();
+      rateSteps = 0;
+    }
+  }
+}
+
+void SimThread::finishReadback() {
+  if (!copyPending)
+    return;
+  ScopedPhase phase(profile, "Readback");
+  copySpace.fence("Readback");
+  snapshots.publish();
+  copyPending = false;
+}
+
+// The field at the current level of detail. The result aliases `reduced`,
+// so it must be consumed before the next call.
+Kokkos::View<float **> SimThread::lod(const Kokkos::View<float **> &field) {
+  if (lodFactor == 1)
+    return field;
+  downsample(field, lodFactor, reduced);
+  return reduced;
+}
+
+void SimThread::readback(DisplayField &dst,
+                         const Kokkos::View<unsigned char *> &stage,
+                         DisplayFormat format) {
+  // Texture rows run along x, see quantize
+  dst.width = HEIGHT / lodFactor;
+  dst.height = WIDTH / lodFactor;
+  auto bytes = std::make_pair(size_t(0), size_t(dst.width) * dst.height *
+                                             texel_bytes(format));
+  Kokkos::deep_copy(copySpace, Kokkos::subview(dst.data, bytes),
+                    Kokkos::subview(stage, bytes));
+  dst.format = format;
+  dst.valid = true;
+}
+
+void SimThread::traceLines(const PanelSettings &params, float frameTime) {
+  int lines = params.streamlineCount;
+  int length = params.streamlineLength;
+  bool reseed = lines != int(lineSeeds.extent(0)) || length != lineLength ||
+                params.pathlines != pathlines;
+
+  if (reseed) {
+    lineSeeds = LinePoints("Line seeds", lines);
+    linePoints = LinePoints("Line points", size_t(lines) * length);
+    lineLength = length;
+    pathlines = params.pathlines;
+    seed_inlet(lineSeeds);
+    if (pathlines)
+      reset_pathlines(lineSeeds, length, linePoints);
+  }
+
+  if (pathlines)
+    advance_pathlines(sim.mac, lineSeeds, length, frameTime, linePoints);
+  else
+    trace_streamlines(sim.mac, lineSeeds, length, params.streamlineStep,
+                      linePoints);
+}
+
+// Reduce, normalize and quantize the displayed fields into the staging
+// buffers and start their copies into `snap`
+void SimThread::stageFields(const PanelSettings &params, Snapshot &snap) {
+  ScopedPhase phase(profile, "Display");
+  DisplayFormat format = DisplayFormat(params.densityFormat);
+
+  int factor = params.matchWindow ? lod_factor(WIDTH, HEIGHT, params.viewWidth,
+                                               params.viewHeight)
+                                  : 1;
+  if (factor != lodFactor) {
+    lodFactor = factor;
+    reduced = Kokkos::View<float **>("Reduced", HEIGHT / factor,
+                                     WIDTH / factor);
+  }
+
+  quantize(lod(sim.density.field.d_view), stageDensity, format);
+  readback(snap.density, stageDensity, format);
+
+  snap.pressure.valid = false;
+  if (params.showPressure) {
+    auto p = lod(sim.mac.pressure.d_view);
+    FieldRange range = field_range(p);
+    range = clipped_range(p, range, params.clip * 0.01f);
+    normalize(p, stagePressure, format, range);
+    readback(snap.pressure, stagePressure, format);
+  }
+
+  snap.derived.valid = false;
+  if (params.view == ControlPanel::VIEW_LIC) {
+    // LIC is expensive and changes slowly, refresh it every few frames
+    if (lastView != params.view || ++licFrames >= params.licInterval) {
+      licFrames = 0;
+      if (licNoise.extent(0) == 0) {
+        licNoise = Kokkos::View<float **>("LIC noise", HEIGHT, WIDTH);
+        lic_noise(licNoise);
+      }
+      lic(sim.mac, licNoise, params.licLength, derived);
+      auto d = lod(derived);
+      FieldRange range = field_range(d);
+      range = clipped_range(d, range, params.clip * 0.01f);
+      normalize(d, stageDerived, format, range);
+      readback(snap.derived, stageDerived, format);
+    }
+  } else if (params.view != ControlPanel::VIEW_DENSITY) {
+    Derived field = Derived(params.view - 1);
+    derived_field(sim.mac, field, derived);
+    auto d = lod(derived);
+    FieldRange range = field_range(d);
+    range = clipped_range(d, range, params.clip * 0.01f);
+    if (is_signed(field)) {
+      // Keep zero at the centre of the diverging colormap
+      float m = std::max(std::fabs(range.lo), std::fabs(range.hi));
+      range = {-m, m};
+    }
+    normalize(d, stageDerived, format, range);
+    readback(snap.derived, stageDerived, format);
+  }
+  lastView = params.view;
+}
+
+void SimThread::publish(const PanelSettings &params, float frameTime) {
+  // The previous copy has had a whole frame of steps to finish
+  finishReadback();
+
+  Snapshot &snap = snapshots.back();
+  stageFields(params, snap);
+
+  snap.lines.valid = false;
+  if (params.showStreamlines) {
+    ScopedPhase linesPhase(profile, "Lines");
+    traceLines(params, frameTime);
+    // Only the producer touches the back slot, so it can grow in place
+    if (snap.lines.points.extent(0) != linePoints.extent(0))
+      Kokkos::realloc(snap.lines.points, linePoints.extent(0));
+    Kokkos::deep_copy(copySpace, snap.lines.points, linePoints);
+    snap.lines.lines = lineSeeds.extent(0);
+    snap.lines.length = lineLength;
+    snap.lines.valid = true;
+  }
+  snap.step = steps;
+  snap.stepPhases.clear();
+  snap.framePhases.clear();
+  if (profile.enabled) {
+    snap.stepPhases = sim.profile.summary();
+    snap.framePhases = profile.summary();
+  }
+  copyPending = true;
+}
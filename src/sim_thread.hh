@@ -0,0 +1,132 @@
+#pragma once
+#include <Kokkos_DualView.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "efsim/display.hh"
+#include "efsim/lic.hh"
+#include "efsim/sim.hh"
+#include "efsim/streamlines.hh"
+#include "gui/controlpanel.hh"
+#include "triple_buffer.hh"
+
+// Pinned so device-to-host copies can run asynchronously
+using HostBytes = Kokkos::View<unsigned char *, Kokkos::SharedHostPinnedSpace>;
+
+// A field packed as `format` texels (see quantize), sized for the widest
+// format
+struct DisplayField {
+  HostBytes data;
+  DisplayFormat format = DisplayFormat::Float32;
+  int width = 0; // texture size; may be a reduced level of detail
+  int height = 0;
+  bool valid = false; // false if the field was not read back this frame
+};
+
+// Streamline / pathline vertices, see LinePoints for the layout
+struct LineSet {
+  Kokkos::View<float *[2], Kokkos::LayoutRight, Kokkos::SharedHostPinnedSpace>
+      points; // interleaved x, y, as uploaded
+  int lines = 0;
+  int length = 0;
+  bool valid = false;
+};
+
+// Immutable (once published) copy of the fields the renderer displays
+struct Snapshot {
+  Snapshot(int width, int height);
+
+  DisplayField density;
+  DisplayField pressure;
+  DisplayField derived; // ctrlPanel.view, if not density
+  LineSet lines;
+  long step = 0;
+  // Rolling phase timings, empty unless ctrlPanel.timePhases
+  std::vector<PhaseSummary> stepPhases;  // Sim::step, per step
+  std::vector<PhaseSummary> framePhases; // this thread, per frame
+};
+
+// Runs Sim::step on its own thread so the solver is not throttled by vsync
+// and rendering never waits on a step. Steps are batched into frames of
+// ctrlPanel.frameBudget milliseconds; only the last step of each frame is
+// copied into a triple-buffered Snapshot for the render thread.
+//
+// The fields are box-filtered on device down to the window resolution and
+// quantized to the display format chosen in the control panel, so only
+// what is visible, at 1, 2 or 4 bytes per texel, crosses to the host.
+// The readback is asynchronous: the fields are staged on device and copied
+// to the host on a separate execution space instance while the next frame
+// of steps runs. A snapshot is only published once its copy has completed,
+// so the renderer always shows the previous finished copy.
+//
+// Once started, the simulation thread is the only one allowed to touch the
+// Kokkos views of `sim`; the render thread only reads published snapshots.
+class SimThread {
+public:
+  SimThread(Sim &sim);
+  ~SimThread();
+
+  void start();
+  void stop();
+
+  // Render thread: hand over the latest UI parameters (including pause)
+  void setParams(const ControlPanel &ctrlPanel);
+
+  // Render thread: queue brush strokes; they are rasterized on device
+  // before the next frame of steps, also while paused
+  void paint(const std::vector<Brush> &brushes);
+
+  // Render thread: true if a newer snapshot is available in latest()
+  bool acquire() { return snapshots.consume(); }
+  const Snapshot &latest() const { return snapshots.front(); }
+
+  float stepsPerSecond() const { return sps.load(std::memory_order_relaxed); }
+  int stepsPerFrame() const { return substeps.load(std::memory_order_relaxed); }
+
+private:
+  void run();
+  void publish(const PanelSettings &params, float frameTime);
+  void stageFields(const PanelSettings &params, Snapshot &snap);
+  void traceLines(const PanelSettings &params, float frameTime);
+  Kokkos::View<float **> lod(const Kokkos::View<float **> &field);
+  void readback(DisplayField &dst, const Kokkos::View<unsigned char *> &stage,
+                DisplayFormat format);
+  void finishReadback();
+  void setTracing(bool on);
+
+  Sim &sim;
+  TripleBuffer<Snapshot> snapshots;
+
+  // Device copies of the displayed fields, so the copy can overlap the
+  // next steps without racing on the live fields
+  Kokkos::View<unsigned char *> stageDensity;
+  Kokkos::View<unsigned char *> stagePressure;
+  Kokkos::View<unsigned char *> stageDerived;
+  Kokkos::View<float **> derived; // unpacked derived field
+  Kokkos::View<float **> reduced; // level-of-detail scratch, see lod()
+  int lodFactor = 1;
+  Kokkos::View<float **> licNoise; // allocated on first use
+  int licFrames = 0;
+  int lastView = -1;
+  LinePoints lineSeeds;
+  LinePoints linePoints;
+  int lineLength = 0;
+  bool pathlines = false;
+  PhaseProfile profile; // per-frame work outside Sim::step
+  Kokkos::DefaultExecutionSpace copySpace;
+  bool copyPending = false;
+
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable resume;
+  PanelSettings params; // guarded by mutex
+  std::vector<Brush> pendingBrushes; // guarded by mutex
+  bool running = false;
+
+  long steps = 0;
+  std::atomic<float> sps{0.0f};
+  std::atomic<int> substeps{0};
+};
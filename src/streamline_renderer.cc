@@ -2,13 +2,21 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include "consts.hh"
+#include "efsim/trace.hh"
 
-StreamlineRenderer::StreamlineRenderer() : VAO(0), VBO(0), shader(0), vertex_count(0) {
+static const GLuint RESTART_INDEX = 0xFFFFFFFFu;
+
+StreamlineRenderer::StreamlineRenderer()
+    : VAO(0), VBO(0), EBO(0), shader(0), vertex_count(0), index_count(0),
+      lineCount(0), lineLength(0) {
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
 
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     glBindVertexArray(0);
@@ -19,22 +27,65 @@ StreamlineRenderer::StreamlineRenderer() : VAO(0), VBO(0), shader(0), vertex_cou
 
 StreamlineRenderer::~StreamlineRenderer() {
     glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
     glDeleteVertexArrays(1, &VAO);
     glDeleteProgram(shader);
 }
 
 void StreamlineRenderer::update(const std::vector<float>& points) {
     vertex_count = points.size() / 2;
+    index_count = 0;
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(float), points.data(), GL_DYNAMIC_DRAW);
 }
 
+void StreamlineRenderer::update(const float* points, int lines, int length) {
+    TraceScope trace("StreamlineRenderer::update");
+    vertex_count = size_t(lines) * length;
+
+    // The index list only depends on the line layout: each line's points
+    // followed by the restart index, so one draw call covers every line
+    if (lines != lineCount || length != lineLength || index_count == 0) {
+        lineCount = lines;
+        lineLength = length;
+        std::vector<GLuint> indices;
+        indices.reserve(size_t(lines) * (length + 1));
+        for (int k = 0; k < lines; k++) {
+            for (int n = 0; n < length; n++)
+                indices.push_back(GLuint(k * length + n));
+            indices.push_back(RESTART_INDEX);
+        }
+        index_count = indices.size();
+
+        glBindVertexArray(VAO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                     indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+    }
+
+    // Orphan the old storage so the upload never waits on the last draw
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count * 2 * sizeof(float), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_count * 2 * sizeof(float), points);
+}
+
 void StreamlineRenderer::draw() {
     if(vertex_count == 0) return;
 
     glUseProgram(shader);
     glBindVertexArray(VAO);
-    glDrawArrays(GL_LINE_STRIP, 0, vertex_count);
+    if (index_count) {
+        // Points are in grid coordinates
+        glUniform2f(glGetUniformLocation(shader, "uGridSize"), WIDTH, HEIGHT);
+        glUniform1i(glGetUniformLocation(shader, "uGridCoords"), 1);
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(RESTART_INDEX);
+        glDrawElements(GL_LINE_STRIP, index_count, GL_UNSIGNED_INT, nullptr);
+        glDisable(GL_PRIMITIVE_RESTART);
+    } else {
+        glUniform1i(glGetUniformLocation(shader, "uGridCoords"), 0);
+        glDrawArrays(GL_LINE_STRIP, 0, vertex_count);
+    }
     glBindVertexArray(0);
 }
 
@@ -11,13 +11,19 @@ public:
     // Upload new streamline points (x,y in [-1,1])
     void update(const std::vector<float>& points);
 
+    // Upload `lines` polylines of `length` points each, stored back to back
+    // in grid coordinates (see LinePoints)
+    void update(const float* points, int lines, int length);
+
     // Draw all streamlines
     void draw();
 
 private:
-    GLuint VAO, VBO;
+    GLuint VAO, VBO, EBO;
     GLuint shader;
     size_t vertex_count;
+    size_t index_count;   // 0 when drawing a single plain strip
+    int lineCount, lineLength;
 
     GLuint make_shader(const std::string &vertPath, const std::string &fragPath);
     unsigned int make_module(const std::string &filepath, unsigned int type);
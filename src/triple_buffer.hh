@@ -0,0 +1,41 @@
+#pragma once
+#include <array>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer triple buffer.
+//
+// The producer fills back(), then publish() swaps it with the shared middle
+// slot. The consumer calls consume() and, if a newer slot was published,
+// reads it through front(). Neither side ever waits on the other; the
+// consumer simply skips any intermediate publishes it did not get to.
+template <typename T> class TripleBuffer {
+public:
+  template <typename... Args>
+  explicit TripleBuffer(const Args &...args)
+      : buffers{T(args...), T(args...), T(args...)} {}
+
+  // Producer side
+  T &back() { return buffers[backIdx]; }
+  void publish() {
+    backIdx = state.exchange(backIdx | FRESH, std::memory_order_acq_rel) &
+              INDEX;
+  }
+
+  // Consumer side: returns true if front() now holds a newer slot
+  bool consume() {
+    if (!(state.load(std::memory_order_relaxed) & FRESH))
+      return false;
+    frontIdx = state.exchange(frontIdx, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+  const T &front() const { return buffers[frontIdx]; }
+
+private:
+  static constexpr int INDEX = 0x3;
+  static constexpr int FRESH = 0x4;
+
+  std::array<T, 3> buffers;
+  int backIdx = 0;
+  int frontIdx = 1;
+  std::atomic<int> state{2}; // middle slot index + FRESH bit
+};